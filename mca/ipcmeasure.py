@@ -1,3 +1,5 @@
+import json
+import math
 import os
 import sys
 
@@ -16,30 +18,30 @@ def GetSeqs(seqname):
 
     return funcNames, funcSeqs
 
+def RoundIPC(ipc):
+    # Labels were computed from the IPC printed by the text report, which is
+    # rounded to 2 decimals. Round the same way, so that functions whose IPCs
+    # tie in the text report keep the 'greedy' label.
+    return math.floor(ipc * 100 + 0.5) / 100
+
 def GetIPCValues(mcaname):
-    funcNames =[]
+    # Result files hold one JSON record per function (-output-format=json).
+    funcNames = []
     ipcs = []
-    lines = list(open(mcaname))
-    for line in lines:
-        elems = line.split(' ')
-        if (elems[0] == 'Function' and elems[1] == 'Name:'):
-            # Add function names
-            funcNames.append(elems[2])
-        if (elems[0] == 'IPC:'):
-            # Add IPC value
-            values = line.split(':')
-            strVal = values[1]
-            try: 
-                ipcs.append(strVal)
-            except (ValueError):
-                print('Wrong IPC value: ' + strVal)
+    for line in open(mcaname):
+        try:
+            record = json.loads(line)
+        except (ValueError):
+            print('Wrong record: ' + line)
+            return [], []
+        # Skip the default region, which precedes the first function.
+        if not record['Description']:
+            continue
+        funcNames.append(record['Description'])
+        ipcs.append(RoundIPC(record['SummaryView']['IPC']))
 
-    if (len(funcNames) != len(ipcs)):
-        funcNames[:] = []
-        ipcs[:] = []
-        
     return funcNames, ipcs
-            
+
 def GetIPCLabel(filename, seqname, mcaname_greedy, mcaname_pbqp, outputname):
     try:
         seqnames, seqs = GetSeqs(seqname)
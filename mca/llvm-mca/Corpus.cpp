@@ -0,0 +1,144 @@
+//===--------------------------- Corpus.cpp --------------------*- C++ -* -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements the utilities used by the corpus mode of llvm-mca.
+///
+//===----------------------------------------------------------------------===//
+
+#include "Corpus.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include <deque>
+#include <mutex>
+
+using namespace llvm;
+
+namespace mca {
+
+static bool isSelected(StringRef Input, StringRef Prefix) {
+  return sys::path::filename(Input).startswith(Prefix);
+}
+
+Expected<std::vector<std::string>> collectCorpusInputs(StringRef Path,
+                                                       StringRef Prefix) {
+  std::vector<std::string> Inputs;
+
+  if (sys::fs::is_directory(Path)) {
+    std::error_code EC;
+    for (sys::fs::recursive_directory_iterator I(Path, EC), E; I != E && !EC;
+         I.increment(EC)) {
+      StringRef File = I->path();
+      if (sys::path::extension(File) != ".s" || !isSelected(File, Prefix))
+        continue;
+      if (sys::fs::is_regular_file(File))
+        Inputs.push_back(File.str());
+    }
+    if (EC)
+      return errorCodeToError(EC);
+  } else {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> ListOrErr =
+        MemoryBuffer::getFile(Path);
+    if (std::error_code EC = ListOrErr.getError())
+      return make_error<StringError>(Path + ": " + EC.message(), EC);
+
+    SmallVector<StringRef, 64> Lines;
+    (*ListOrErr)->getBuffer().split(Lines, '\n', -1, false);
+    for (StringRef Line : Lines) {
+      Line = Line.trim();
+      if (!Line.empty() && isSelected(Line, Prefix))
+        Inputs.push_back(Line.str());
+    }
+  }
+
+  llvm::sort(Inputs.begin(), Inputs.end());
+  return std::move(Inputs);
+}
+
+// Returns the path of Input relative to directory Root, or an empty string if
+// Input is not in Root.
+static StringRef getRelativePath(StringRef Input, StringRef Root) {
+  if (Root.empty() || !Input.startswith(Root))
+    return StringRef();
+  StringRef Relative = Input.drop_front(Root.size());
+  if (!sys::path::is_separator(Root.back())) {
+    if (Relative.empty() || !sys::path::is_separator(Relative.front()))
+      return StringRef();
+  }
+  return Relative.drop_while([](char C) { return sys::path::is_separator(C); });
+}
+
+std::string getCorpusResultPath(StringRef Input, StringRef Root,
+                                StringRef OutputDir) {
+  SmallString<256> Result(OutputDir);
+  StringRef Relative = getRelativePath(Input, Root);
+  if (Relative.empty())
+    Relative = sys::path::filename(Input);
+  sys::path::append(Result, Relative);
+  sys::path::replace_extension(Result, ".res");
+  return Result.str().str();
+}
+
+namespace {
+// A queue of task indices owned by a worker.
+struct WorkQueue {
+  std::mutex Lock;
+  std::deque<unsigned> Tasks;
+};
+} // end of anonymous namespace
+
+// Pops a task from the front of Queue if FromFront is true, and from the back
+// of it otherwise. Returns false if Queue is empty.
+static bool takeTask(WorkQueue &Queue, bool FromFront, unsigned &Task) {
+  std::lock_guard<std::mutex> Guard(Queue.Lock);
+  if (Queue.Tasks.empty())
+    return false;
+  if (FromFront) {
+    Task = Queue.Tasks.front();
+    Queue.Tasks.pop_front();
+  } else {
+    Task = Queue.Tasks.back();
+    Queue.Tasks.pop_back();
+  }
+  return true;
+}
+
+void runWorkStealing(unsigned NumTasks, unsigned NumWorkers,
+                     function_ref<void(unsigned)> Task) {
+  NumWorkers = std::max(1U, std::min(NumWorkers, NumTasks));
+  std::vector<WorkQueue> Queues(NumWorkers);
+  for (unsigned I = 0; I < NumTasks; ++I)
+    Queues[I % NumWorkers].Tasks.push_back(I);
+
+  // New tasks are never added once workers have started. So, a worker can
+  // exit as soon as it finds every queue empty.
+  auto Worker = [&](unsigned WorkerID) {
+    unsigned Next;
+    for (;;) {
+      bool Found = takeTask(Queues[WorkerID], /* FromFront */ true, Next);
+      for (unsigned I = 1; I < NumWorkers && !Found; ++I) {
+        WorkQueue &Victim = Queues[(WorkerID + I) % NumWorkers];
+        Found = takeTask(Victim, /* FromFront */ false, Next);
+      }
+      if (!Found)
+        return;
+      Task(Next);
+    }
+  };
+
+  ThreadPool Pool(NumWorkers);
+  for (unsigned I = 0; I < NumWorkers; ++I)
+    Pool.async(Worker, I);
+  Pool.wait();
+}
+
+} // namespace mca
@@ -0,0 +1,59 @@
+//===---------------------------- Corpus.h ---------------------*- C++ -* -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file declares utilities used by the corpus mode of llvm-mca.
+///
+/// In corpus mode, llvm-mca analyzes a large set of assembly files in a single
+/// process. Target description objects are created only once, and inputs are
+/// distributed among worker threads. Every input produces a result file
+/// named after the input, so inputs that already have a result can be skipped.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCA_CORPUS_H
+#define LLVM_TOOLS_LLVM_MCA_CORPUS_H
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include <string>
+#include <vector>
+
+namespace mca {
+
+/// Returns the list of inputs of a corpus, sorted by path.
+///
+/// If Path is a directory, then every assembly file (*.s) in that directory
+/// and its subdirectories is an input. Otherwise, Path is a text file that
+/// lists one input per line. Only inputs whose file name starts with Prefix
+/// are returned.
+llvm::Expected<std::vector<std::string>>
+collectCorpusInputs(llvm::StringRef Path, llvm::StringRef Prefix);
+
+/// Returns the path of the result file for Input. The result file is named
+/// after Input, with extension ".res". If Input is in directory Root, then the
+/// result file has the same path relative to OutputDir as Input relative to
+/// Root, so that inputs with the same name in different subdirectories don't
+/// share a result file. Otherwise, it is created directly in OutputDir.
+std::string getCorpusResultPath(llvm::StringRef Input, llvm::StringRef Root,
+                                llvm::StringRef OutputDir);
+
+/// Runs tasks [0, NumTasks) on NumWorkers threads.
+///
+/// Tasks are initially distributed in round-robin order among per-worker
+/// queues. A worker takes tasks from the front of its own queue. Once its
+/// queue is empty, it steals tasks from the back of the other queues. That
+/// way, workers stay busy even if task durations are very different.
+void runWorkStealing(unsigned NumTasks, unsigned NumWorkers,
+                     llvm::function_ref<void(unsigned)> Task);
+
+} // namespace mca
+
+#endif
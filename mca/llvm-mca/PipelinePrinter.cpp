@@ -23,4 +23,12 @@ void PipelinePrinter::printReport(llvm::raw_ostream &OS) const {
   for (const auto &V : Views)
     V->printView(OS);
 }
+
+void PipelinePrinter::writeReport(ReportWriter &W) const {
+  for (const auto &V : Views) {
+    W.startView(V->getName());
+    V->writeView(W);
+    W.endView();
+  }
+}
 } // namespace mca.
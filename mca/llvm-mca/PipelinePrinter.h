@@ -46,6 +46,9 @@ public:
   }
 
   void printReport(llvm::raw_ostream &OS) const;
+
+  // Writes one section per view to the current region record of W.
+  void writeReport(ReportWriter &W) const;
 };
 } // namespace mca
 
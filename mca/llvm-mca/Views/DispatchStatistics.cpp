@@ -33,6 +33,22 @@ void DispatchStatistics::onEvent(const HWInstructionEvent &Event) {
   NumDispatched += DE.MicroOpcodes;
 }
 
+void DispatchStatistics::onPeriodBegin() {
+  PeriodStartCycles = NumCycles;
+  PeriodStartStalls = HWStalls;
+  PeriodStartGroupSizes = DispatchGroupSizePerCycle;
+}
+
+void DispatchStatistics::onPeriodEnd(unsigned NumRepeats) {
+  NumCycles += (NumCycles - PeriodStartCycles) * NumRepeats;
+  for (unsigned I = 0, E = HWStalls.size(); I < E; ++I)
+    HWStalls[I] += (HWStalls[I] - PeriodStartStalls[I]) * NumRepeats;
+  for (Histogram::value_type &Entry : DispatchGroupSizePerCycle) {
+    unsigned Delta = Entry.second - PeriodStartGroupSizes[Entry.first];
+    Entry.second += Delta * NumRepeats;
+  }
+}
+
 void DispatchStatistics::printDispatchHistogram(llvm::raw_ostream &OS) const {
   std::string Buffer;
   raw_string_ostream TempStream(Buffer);
@@ -83,4 +99,28 @@ void DispatchStatistics::printDispatchStalls(raw_ostream &OS) const {
   OS << Buffer;
 }
 
+void DispatchStatistics::writeView(ReportWriter &W) const {
+  W.writeInteger("NumCycles", NumCycles);
+  W.writeInteger("RegisterFileStalls",
+                 HWStalls[HWStallEvent::RegisterFileStall]);
+  W.writeInteger("RetireControlUnitStalls",
+                 HWStalls[HWStallEvent::RetireControlUnitStall]);
+  W.writeInteger("SchedulerQueueFullStalls",
+                 HWStalls[HWStallEvent::SchedulerQueueFull]);
+  W.writeInteger("LoadQueueFullStalls", HWStalls[HWStallEvent::LoadQueueFull]);
+  W.writeInteger("StoreQueueFullStalls",
+                 HWStalls[HWStallEvent::StoreQueueFull]);
+  W.writeInteger("DispatchGroupStalls",
+                 HWStalls[HWStallEvent::DispatchGroupStall]);
+
+  W.startTable("DispatchGroupSizes");
+  for (const std::pair<unsigned, unsigned> &Entry : DispatchGroupSizePerCycle) {
+    W.startRow();
+    W.writeInteger("NumDispatched", Entry.first);
+    W.writeInteger("NumCycles", Entry.second);
+    W.endRow();
+  }
+  W.endTable();
+}
+
 } // namespace mca
@@ -52,6 +52,12 @@ class DispatchStatistics : public View {
   using Histogram = std::map<unsigned, unsigned>;
   Histogram DispatchGroupSizePerCycle;
 
+  // Snapshot of the statistics taken at the beginning of a steady-state
+  // period.
+  unsigned PeriodStartCycles;
+  llvm::SmallVector<unsigned, 8> PeriodStartStalls;
+  Histogram PeriodStartGroupSizes;
+
   void updateHistograms() {
     DispatchGroupSizePerCycle[NumDispatched]++;
     NumDispatched = 0;
@@ -64,7 +70,13 @@ class DispatchStatistics : public View {
 public:
   DispatchStatistics()
       : NumDispatched(0), NumCycles(0),
-        HWStalls(HWStallEvent::LastGenericEvent) {}
+        HWStalls(HWStallEvent::LastGenericEvent), PeriodStartCycles(0) {}
+
+  EventMask getSubscribedEvents() const override {
+    return eventMask(Stall) | eventMask(InstructionDispatched) |
+           eventMask(CycleBegin) | eventMask(CycleEnd) |
+           eventMask(PeriodBoundary);
+  }
 
   void onEvent(const HWStallEvent &Event) override;
 
@@ -74,10 +86,18 @@ public:
 
   void onCycleEnd() override { updateHistograms(); }
 
+  void onPeriodBegin() override;
+
+  void onPeriodEnd(unsigned NumRepeats) override;
+
   void printView(llvm::raw_ostream &OS) const override {
     printDispatchStalls(OS);
     printDispatchHistogram(OS);
   }
+
+  llvm::StringRef getName() const override { return "DispatchStatistics"; }
+
+  void writeView(ReportWriter &W) const override;
 };
 } // namespace mca
 
@@ -18,10 +18,25 @@ namespace mca {
 
 using namespace llvm;
 
+const MCSchedClassDesc &
+InstructionInfoView::getSchedClassDesc(const MCInst &Inst) const {
+  const MCSchedModel &SM = STI.getSchedModel();
+  const MCInstrDesc &MCDesc = MCII.get(Inst.getOpcode());
+
+  // Obtain the scheduling class information from the instruction.
+  unsigned SchedClassID = MCDesc.getSchedClass();
+  unsigned CPUID = SM.getProcessorID();
+
+  // Try to solve variant scheduling classes.
+  while (SchedClassID && SM.getSchedClassDesc(SchedClassID)->isVariant())
+    SchedClassID = STI.resolveVariantSchedClass(SchedClassID, &Inst, CPUID);
+
+  return *SM.getSchedClassDesc(SchedClassID);
+}
+
 void InstructionInfoView::printView(raw_ostream &OS) const {
   std::string Buffer;
   raw_string_ostream TempStream(Buffer);
-  const MCSchedModel &SM = STI.getSchedModel();
   unsigned Instructions = Source.size();
 
   std::string Instruction;
@@ -35,16 +50,7 @@ void InstructionInfoView::printView(raw_ostream &OS) const {
   for (unsigned I = 0, E = Instructions; I < E; ++I) {
     const MCInst &Inst = Source.getMCInstFromIndex(I);
     const MCInstrDesc &MCDesc = MCII.get(Inst.getOpcode());
-
-    // Obtain the scheduling class information from the instruction.
-    unsigned SchedClassID = MCDesc.getSchedClass();
-    unsigned CPUID = SM.getProcessorID();
-
-    // Try to solve variant scheduling classes.
-    while (SchedClassID && SM.getSchedClassDesc(SchedClassID)->isVariant())
-      SchedClassID = STI.resolveVariantSchedClass(SchedClassID, &Inst, CPUID);
-
-    const MCSchedClassDesc &SCDesc = *SM.getSchedClassDesc(SchedClassID);
+    const MCSchedClassDesc &SCDesc = getSchedClassDesc(Inst);
     unsigned NumMicroOpcodes = SCDesc.NumMicroOps;
     unsigned Latency = MCSchedModel::computeInstrLatency(STI, SCDesc);
     Optional<double> RThroughput =
@@ -88,4 +94,34 @@ void InstructionInfoView::printView(raw_ostream &OS) const {
   TempStream.flush();
   OS << Buffer;
 }
+
+void InstructionInfoView::writeView(ReportWriter &W) const {
+  std::string Instruction;
+  raw_string_ostream InstrStream(Instruction);
+
+  W.startTable("Instructions");
+  for (unsigned I = 0, E = Source.size(); I < E; ++I) {
+    const MCInst &Inst = Source.getMCInstFromIndex(I);
+    const MCInstrDesc &MCDesc = MCII.get(Inst.getOpcode());
+    const MCSchedClassDesc &SCDesc = getSchedClassDesc(Inst);
+
+    MCIP.printInst(&Inst, InstrStream, "", STI);
+    InstrStream.flush();
+
+    W.startRow();
+    W.writeString("Instruction", StringRef(Instruction).ltrim());
+    W.writeInteger("NumMicroOpcodes", SCDesc.NumMicroOps);
+    W.writeInteger("Latency", MCSchedModel::computeInstrLatency(STI, SCDesc));
+    Optional<double> RThroughput =
+        MCSchedModel::getReciprocalThroughput(STI, SCDesc);
+    if (RThroughput.hasValue())
+      W.writeNumber("RThroughput", RThroughput.getValue());
+    W.writeBool("MayLoad", MCDesc.mayLoad());
+    W.writeBool("MayStore", MCDesc.mayStore());
+    W.writeBool("HasSideEffects", MCDesc.hasUnmodeledSideEffects());
+    W.endRow();
+    Instruction = "";
+  }
+  W.endTable();
+}
 } // namespace mca.
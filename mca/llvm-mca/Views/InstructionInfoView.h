@@ -53,13 +53,22 @@ class InstructionInfoView : public View {
   const SourceMgr &Source;
   llvm::MCInstPrinter &MCIP;
 
+  // Returns the scheduling class of Inst. Variant classes are resolved.
+  const llvm::MCSchedClassDesc &
+  getSchedClassDesc(const llvm::MCInst &Inst) const;
+
 public:
   InstructionInfoView(const llvm::MCSubtargetInfo &sti,
                       const llvm::MCInstrInfo &mcii, const SourceMgr &S,
                       llvm::MCInstPrinter &IP)
       : STI(sti), MCII(mcii), Source(S), MCIP(IP) {}
 
+  // This view does not observe the simulation.
+  EventMask getSubscribedEvents() const override { return 0; }
+
   void printView(llvm::raw_ostream &OS) const override;
+  llvm::StringRef getName() const override { return "InstructionInfoView"; }
+  void writeView(ReportWriter &W) const override;
 };
 } // namespace mca
 
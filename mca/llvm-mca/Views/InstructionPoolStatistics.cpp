@@ -0,0 +1,44 @@
+//===--------------------- InstructionPoolStatistics.cpp --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements the InstructionPoolStatistics interface.
+///
+//===----------------------------------------------------------------------===//
+
+#include "Views/InstructionPoolStatistics.h"
+
+using namespace llvm;
+
+namespace mca {
+
+void InstructionPoolStatistics::printView(raw_ostream &OS) const {
+  const InstructionPoolStats &Stats = IB.getInstructionPoolStats();
+  std::string Buffer;
+  raw_string_ostream TempStream(Buffer);
+  TempStream << "\n\nInstruction Pool:\n";
+  TempStream << "Instructions created:       " << Stats.NumCreated << '\n';
+  TempStream << "Reused from pool:           " << Stats.NumReused << '\n';
+  TempStream << "Heap allocations:           " << Stats.NumAllocations << '\n';
+  TempStream << "Max instructions in flight: " << Stats.MaxInFlight << '\n';
+  TempStream << "Pool size (bytes):          " << Stats.PoolSize << '\n';
+  TempStream.flush();
+  OS << Buffer;
+}
+
+void InstructionPoolStatistics::writeView(ReportWriter &W) const {
+  const InstructionPoolStats &Stats = IB.getInstructionPoolStats();
+  W.writeInteger("NumCreated", Stats.NumCreated);
+  W.writeInteger("NumReused", Stats.NumReused);
+  W.writeInteger("NumAllocations", Stats.NumAllocations);
+  W.writeInteger("MaxInFlight", Stats.MaxInFlight);
+  W.writeInteger("PoolSize", Stats.PoolSize);
+}
+
+} // namespace mca
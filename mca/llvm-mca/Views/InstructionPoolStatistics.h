@@ -0,0 +1,53 @@
+//===--------------------- InstructionPoolStatistics.h ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file defines class InstructionPoolStatistics: a view that prints
+/// statistics about the allocation of instructions by the InstrBuilder.
+///
+/// Example:
+/// ========
+///
+/// Instruction Pool:
+/// Instructions created:       400
+/// Reused from pool:           338
+/// Heap allocations:           62
+/// Max instructions in flight: 62
+/// Pool size (bytes):          18848
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCA_INSTRUCTIONPOOLSTATISTICS_H
+#define LLVM_TOOLS_LLVM_MCA_INSTRUCTIONPOOLSTATISTICS_H
+
+#include "InstrBuilder.h"
+#include "Views/View.h"
+
+namespace mca {
+
+class InstructionPoolStatistics : public View {
+  const InstrBuilder &IB;
+
+public:
+  InstructionPoolStatistics(const InstrBuilder &Builder) : IB(Builder) {}
+
+  // This view does not observe the simulation.
+  EventMask getSubscribedEvents() const override { return 0; }
+
+  void printView(llvm::raw_ostream &OS) const override;
+
+  llvm::StringRef getName() const override {
+    return "InstructionPoolStatistics";
+  }
+
+  void writeView(ReportWriter &W) const override;
+};
+} // namespace mca
+
+#endif
@@ -0,0 +1,97 @@
+//===--------------------- PipelineProfileView.cpp --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements the PipelineProfileView interface.
+///
+//===----------------------------------------------------------------------===//
+
+#include "Views/PipelineProfileView.h"
+#include "llvm/Support/Format.h"
+
+using namespace llvm;
+
+namespace mca {
+
+using Counter = PipelineProfiler::Counter;
+
+static double toMilliseconds(PipelineProfiler::Clock::duration Time) {
+  return std::chrono::duration<double, std::milli>(Time).count();
+}
+
+void PipelineProfileView::printView(raw_ostream &OS) const {
+  PipelineProfiler::Clock::duration Total =
+      Profiler.getPipelineCounter().Time;
+  for (const Counter &C : Profiler.getStageCounters())
+    Total += C.Time;
+  for (const Counter &C : Profiler.getListenerCounters())
+    Total += C.Time;
+  double TotalMs = toMilliseconds(Total);
+
+  std::string Buffer;
+  raw_string_ostream TempStream(Buffer);
+  auto PrintCounter = [&](const Counter &C) {
+    double Ms = toMilliseconds(C.Time);
+    TempStream << format("%-24s %10llu %10.3f %7.1f%%\n", C.Name.c_str(),
+                         (unsigned long long)C.Calls, Ms,
+                         TotalMs ? Ms * 100.0 / TotalMs : 0.0);
+  };
+
+  TempStream << "\n\nPipeline Profile:\n";
+  TempStream << "[Stage]                       Calls  Time (ms)        %\n";
+  PrintCounter(Profiler.getPipelineCounter());
+  for (const Counter &C : Profiler.getStageCounters())
+    PrintCounter(C);
+
+  if (!Profiler.getListenerCounters().empty()) {
+    TempStream << "\n[Listener]                   Events  Time (ms)        %\n";
+    for (const Counter &C : Profiler.getListenerCounters())
+      PrintCounter(C);
+  }
+
+  const PipelineProfiler::SchedulerCounters &SC =
+      Profiler.getSchedulerCounters();
+  TempStream << "\nScheduler scans:\n";
+  TempStream << "WaitSet updates:          " << SC.WaitSetUpdates << '\n';
+  TempStream << "PendingSet entries:       " << SC.PendingSetScans << '\n';
+  TempStream << "ReadySet queues:          " << SC.ReadyQueueScans << '\n';
+  TempStream << "IssuedSet entries:        " << SC.IssuedSetScans << '\n';
+  TempStream.flush();
+  OS << Buffer;
+}
+
+void PipelineProfileView::writeView(ReportWriter &W) const {
+  auto WriteCounter = [&](const Counter &C, StringRef CallsKey) {
+    W.startRow();
+    W.writeString("Name", C.Name);
+    W.writeInteger(CallsKey, C.Calls);
+    W.writeNumber("TimeMs", toMilliseconds(C.Time));
+    W.endRow();
+  };
+
+  W.startTable("Stages");
+  WriteCounter(Profiler.getPipelineCounter(), "Calls");
+  for (const Counter &C : Profiler.getStageCounters())
+    WriteCounter(C, "Calls");
+  W.endTable();
+
+  W.startTable("Listeners");
+  for (const Counter &C : Profiler.getListenerCounters())
+    WriteCounter(C, "Events");
+  W.endTable();
+
+  const PipelineProfiler::SchedulerCounters &SC =
+      Profiler.getSchedulerCounters();
+  W.writeInteger("WaitSetUpdates", SC.WaitSetUpdates);
+  W.writeInteger("PendingSetScans", SC.PendingSetScans);
+  W.writeInteger("ReadyQueueScans", SC.ReadyQueueScans);
+  W.writeInteger("IssuedSetScans", SC.IssuedSetScans);
+}
+
+} // namespace mca
@@ -0,0 +1,61 @@
+//===--------------------- PipelineProfileView.h ----------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file defines class PipelineProfileView: a view that prints where the
+/// time of the simulation went (see class PipelineProfiler).
+///
+/// Example:
+/// ========
+///
+/// Pipeline Profile:
+/// [Stage]                       Calls  Time (ms)        %
+/// Pipeline                          1      0.210     5.8%
+/// FetchStage                      612      1.402    38.6%
+/// DispatchStage                  1024      0.512    14.1%
+/// ExecuteStage                   1012      1.034    28.5%
+/// RetireStage                    1012      0.120     3.3%
+///
+/// [Listener]                   Events  Time (ms)        %
+/// SummaryView                     712      0.356     9.8%
+///
+/// Scheduler scans:
+/// WaitSet updates:          210
+/// PendingSet entries:       410
+/// ReadySet queues:          812
+/// IssuedSet entries:        905
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCA_PIPELINEPROFILEVIEW_H
+#define LLVM_TOOLS_LLVM_MCA_PIPELINEPROFILEVIEW_H
+
+#include "PipelineProfiler.h"
+#include "Views/View.h"
+
+namespace mca {
+
+class PipelineProfileView : public View {
+  const PipelineProfiler &Profiler;
+
+public:
+  PipelineProfileView(const PipelineProfiler &P) : Profiler(P) {}
+
+  // This view does not observe the simulation.
+  EventMask getSubscribedEvents() const override { return 0; }
+
+  void printView(llvm::raw_ostream &OS) const override;
+
+  llvm::StringRef getName() const override { return "PipelineProfileView"; }
+
+  void writeView(ReportWriter &W) const override;
+};
+} // namespace mca
+
+#endif // LLVM_TOOLS_LLVM_MCA_PIPELINEPROFILEVIEW_H
@@ -21,7 +21,7 @@ namespace mca {
 
 void RegisterFileStatistics::initializeRegisterFileInfo() {
   const MCSchedModel &SM = STI.getSchedModel();
-  RegisterFileUsage Empty = {0, 0, 0};
+  RegisterFileUsage Empty = {0, 0, 0, 0};
   if (!SM.hasExtraProcessorInfo()) {
     // Assume a single register file.
     RegisterFiles.emplace_back(Empty);
@@ -63,6 +63,17 @@ void RegisterFileStatistics::onEvent(const HWInstructionEvent &Event) {
   }
 }
 
+void RegisterFileStatistics::onPeriodBegin() {
+  for (RegisterFileUsage &RFU : RegisterFiles)
+    RFU.PeriodStartMappings = RFU.TotalMappings;
+}
+
+void RegisterFileStatistics::onPeriodEnd(unsigned NumRepeats) {
+  for (RegisterFileUsage &RFU : RegisterFiles)
+    RFU.TotalMappings +=
+        (RFU.TotalMappings - RFU.PeriodStartMappings) * NumRepeats;
+}
+
 void RegisterFileStatistics::printView(raw_ostream &OS) const {
   std::string Buffer;
   raw_string_ostream TempStream(Buffer);
@@ -104,4 +115,30 @@ void RegisterFileStatistics::printView(raw_ostream &OS) const {
   OS << Buffer;
 }
 
+void RegisterFileStatistics::writeView(ReportWriter &W) const {
+  const RegisterFileUsage &GlobalUsage = RegisterFiles[0];
+  W.writeInteger("TotalMappings", GlobalUsage.TotalMappings);
+  W.writeInteger("MaxUsedMappings", GlobalUsage.MaxUsedMappings);
+
+  W.startTable("RegisterFiles");
+  for (unsigned I = 1, E = RegisterFiles.size(); I < E; ++I) {
+    const RegisterFileUsage &RFU = RegisterFiles[I];
+    const MCExtraProcessorInfo &PI =
+        STI.getSchedModel().getExtraProcessorInfo();
+    const MCRegisterFileDesc &RFDesc = PI.RegisterFiles[I];
+    // Skip invalid register files.
+    if (!RFDesc.NumPhysRegs)
+      continue;
+
+    W.startRow();
+    W.writeInteger("Index", I);
+    W.writeString("Name", RFDesc.Name);
+    W.writeInteger("NumPhysRegs", RFDesc.NumPhysRegs);
+    W.writeInteger("TotalMappings", RFU.TotalMappings);
+    W.writeInteger("MaxUsedMappings", RFU.MaxUsedMappings);
+    W.endRow();
+  }
+  W.endTable();
+}
+
 } // namespace mca
@@ -46,6 +46,8 @@ class RegisterFileStatistics : public View {
     unsigned TotalMappings;
     unsigned MaxUsedMappings;
     unsigned CurrentlyUsedMappings;
+    // Value of TotalMappings at the beginning of a steady-state period.
+    unsigned PeriodStartMappings;
   };
 
   // There is one entry for each register file implemented by the processor.
@@ -58,9 +60,22 @@ public:
     initializeRegisterFileInfo();
   }
 
+  EventMask getSubscribedEvents() const override {
+    return eventMask(InstructionRetired) | eventMask(InstructionDispatched) |
+           eventMask(PeriodBoundary);
+  }
+
   void onEvent(const HWInstructionEvent &Event) override;
 
+  void onPeriodBegin() override;
+
+  void onPeriodEnd(unsigned NumRepeats) override;
+
   void printView(llvm::raw_ostream &OS) const override;
+
+  llvm::StringRef getName() const override { return "RegisterFileStatistics"; }
+
+  void writeView(ReportWriter &W) const override;
 };
 } // namespace mca
 
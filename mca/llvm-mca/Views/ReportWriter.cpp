@@ -0,0 +1,254 @@
+//===--------------------- ReportWriter.cpp ---------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements the JSON and CSV report writers.
+///
+//===----------------------------------------------------------------------===//
+
+#include "Views/ReportWriter.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
+#include <cmath>
+
+namespace mca {
+
+using namespace llvm;
+
+namespace {
+
+class JSONReportWriter final : public ReportWriter {
+  // One entry per open object or array. An entry is true if the object or
+  // array already contains an element.
+  SmallVector<bool, 8> HasElements;
+
+  // Starts a new element of the innermost object or array. Key is empty for
+  // the elements of an array.
+  void startElement(StringRef Key);
+  void open(StringRef Key, char Bracket) {
+    startElement(Key);
+    OS << Bracket;
+    HasElements.push_back(false);
+  }
+  void close(char Bracket) {
+    assert(!HasElements.empty() && "Unbalanced report!");
+    HasElements.pop_back();
+    OS << Bracket;
+  }
+
+public:
+  JSONReportWriter(raw_ostream &OS) : ReportWriter(OS) {}
+
+  void startRegion(unsigned Index, StringRef Description) override;
+  void endRegion() override;
+  void startView(StringRef Name) override { open(Name, '{'); }
+  void endView() override { close('}'); }
+  void startTable(StringRef Name) override { open(Name, '['); }
+  void endTable() override { close(']'); }
+  void startRow() override { open(StringRef(), '{'); }
+  void endRow() override { close('}'); }
+
+  void writeInteger(StringRef Key, int64_t Value) override;
+  void writeNumber(StringRef Key, double Value) override;
+  void writeBool(StringRef Key, bool Value) override;
+  void writeString(StringRef Key, StringRef Value) override;
+};
+
+class CSVReportWriter final : public ReportWriter {
+  unsigned Region;
+  std::string View;
+  std::string Table;
+  // Index of the current row, or -1 if values are not written to a row.
+  int Row;
+  unsigned NextRow;
+
+  // Prints the columns that precede the value.
+  void startValue(StringRef Key);
+
+public:
+  CSVReportWriter(raw_ostream &OS)
+      : ReportWriter(OS), Region(0), Row(-1), NextRow(0) {}
+
+  void startRegion(unsigned Index, StringRef Description) override;
+  void endRegion() override {}
+  void startView(StringRef Name) override { View = Name; }
+  void endView() override { View.clear(); }
+  void startTable(StringRef Name) override {
+    Table = Name;
+    NextRow = 0;
+  }
+  void endTable() override { Table.clear(); }
+  void startRow() override { Row = NextRow++; }
+  void endRow() override { Row = -1; }
+
+  void writeInteger(StringRef Key, int64_t Value) override;
+  void writeNumber(StringRef Key, double Value) override;
+  void writeBool(StringRef Key, bool Value) override;
+  void writeString(StringRef Key, StringRef Value) override;
+};
+
+} // end of anonymous namespace
+
+void printJSONString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (char C : Str) {
+    switch (C) {
+    case '"':
+      OS << "\\\"";
+      break;
+    case '\\':
+      OS << "\\\\";
+      break;
+    case '\n':
+      OS << "\\n";
+      break;
+    case '\t':
+      OS << "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(C) < 0x20)
+        OS << format("\\u%04x", static_cast<unsigned>(C));
+      else
+        OS << C;
+    }
+  }
+  OS << '"';
+}
+
+// Fields that contain a separator, a quote or a line break are quoted.
+static void printCSVField(raw_ostream &OS, StringRef Str) {
+  if (Str.find_first_of(",\"\r\n") == StringRef::npos) {
+    OS << Str;
+    return;
+  }
+
+  OS << '"';
+  for (char C : Str) {
+    if (C == '"')
+      OS << '"';
+    OS << C;
+  }
+  OS << '"';
+}
+
+// Numbers are printed with enough digits to be read back exactly.
+static void printNumber(raw_ostream &OS, double Value) {
+  OS << format("%.17g", Value);
+}
+
+void JSONReportWriter::startElement(StringRef Key) {
+  if (!HasElements.empty()) {
+    if (HasElements.back())
+      OS << ',';
+    HasElements.back() = true;
+  }
+
+  if (!Key.empty()) {
+    printJSONString(OS, Key);
+    OS << ':';
+  }
+}
+
+void JSONReportWriter::startRegion(unsigned Index, StringRef Description) {
+  assert(HasElements.empty() && "Regions cannot be nested!");
+  open(StringRef(), '{');
+  writeInteger("Region", Index);
+  writeString("Description", Description);
+}
+
+void JSONReportWriter::endRegion() {
+  close('}');
+  OS << '\n';
+}
+
+void JSONReportWriter::writeInteger(StringRef Key, int64_t Value) {
+  startElement(Key);
+  OS << Value;
+}
+
+void JSONReportWriter::writeNumber(StringRef Key, double Value) {
+  startElement(Key);
+  // JSON cannot represent infinities and NaNs.
+  if (!std::isfinite(Value))
+    OS << "null";
+  else
+    printNumber(OS, Value);
+}
+
+void JSONReportWriter::writeBool(StringRef Key, bool Value) {
+  startElement(Key);
+  OS << (Value ? "true" : "false");
+}
+
+void JSONReportWriter::writeString(StringRef Key, StringRef Value) {
+  startElement(Key);
+  printJSONString(OS, Value);
+}
+
+void CSVReportWriter::startValue(StringRef Key) {
+  OS << Region << ',';
+  printCSVField(OS, View);
+  OS << ',';
+  printCSVField(OS, Table);
+  OS << ',';
+  if (Row >= 0)
+    OS << Row;
+  OS << ',';
+  printCSVField(OS, Key);
+  OS << ',';
+}
+
+void CSVReportWriter::startRegion(unsigned Index, StringRef Description) {
+  Region = Index;
+  writeString("Description", Description);
+}
+
+void CSVReportWriter::writeInteger(StringRef Key, int64_t Value) {
+  startValue(Key);
+  OS << Value << '\n';
+}
+
+void CSVReportWriter::writeNumber(StringRef Key, double Value) {
+  startValue(Key);
+  printNumber(OS, Value);
+  OS << '\n';
+}
+
+void CSVReportWriter::writeBool(StringRef Key, bool Value) {
+  startValue(Key);
+  OS << (Value ? "true" : "false") << '\n';
+}
+
+void CSVReportWriter::writeString(StringRef Key, StringRef Value) {
+  startValue(Key);
+  printCSVField(OS, Value);
+  OS << '\n';
+}
+
+void printReportHeader(OutputFormat Format, raw_ostream &OS) {
+  if (Format == OutputFormat::CSV)
+    OS << "region,view,table,row,key,value\n";
+}
+
+std::unique_ptr<ReportWriter> createReportWriter(OutputFormat Format,
+                                                 raw_ostream &OS) {
+  switch (Format) {
+  case OutputFormat::JSON:
+    return llvm::make_unique<JSONReportWriter>(OS);
+  case OutputFormat::CSV:
+    return llvm::make_unique<CSVReportWriter>(OS);
+  case OutputFormat::Text:
+    break;
+  }
+  llvm_unreachable("Text reports are printed by the views!");
+}
+
+} // namespace mca
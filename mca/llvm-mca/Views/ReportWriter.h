@@ -0,0 +1,75 @@
+//===--------------------- ReportWriter.h -----------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file defines class ReportWriter, which is used by the views to emit
+/// a machine readable report.
+///
+/// A report is a sequence of region records. A region record contains one
+/// section per view. A section contains named values and tables, and a table
+/// is a sequence of rows of named values. Every value is streamed to the
+/// output as soon as it is written:
+///
+///  - The JSON writer prints one JSON object per code region, on a single
+///    line (i.e. JSON Lines). Sections are objects, and tables are arrays of
+///    objects.
+///  - The CSV writer prints one line per value, with columns:
+///    region,view,table,row,key,value
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCA_REPORTWRITER_H
+#define LLVM_TOOLS_LLVM_MCA_REPORTWRITER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+
+namespace mca {
+
+enum class OutputFormat { Text, JSON, CSV };
+
+class ReportWriter {
+protected:
+  llvm::raw_ostream &OS;
+
+public:
+  ReportWriter(llvm::raw_ostream &OS) : OS(OS) {}
+  virtual ~ReportWriter() = default;
+
+  virtual void startRegion(unsigned Index, llvm::StringRef Description) = 0;
+  virtual void endRegion() = 0;
+  virtual void startView(llvm::StringRef Name) = 0;
+  virtual void endView() = 0;
+  virtual void startTable(llvm::StringRef Name) = 0;
+  virtual void endTable() = 0;
+  virtual void startRow() = 0;
+  virtual void endRow() = 0;
+
+  virtual void writeInteger(llvm::StringRef Key, int64_t Value) = 0;
+  virtual void writeNumber(llvm::StringRef Key, double Value) = 0;
+  virtual void writeBool(llvm::StringRef Key, bool Value) = 0;
+  virtual void writeString(llvm::StringRef Key, llvm::StringRef Value) = 0;
+};
+
+/// Prints the header of a report in format Format. It must be printed once,
+/// before the first region record.
+void printReportHeader(OutputFormat Format, llvm::raw_ostream &OS);
+
+/// Returns a writer of structured reports in format Format, which must not
+/// be OutputFormat::Text.
+std::unique_ptr<ReportWriter> createReportWriter(OutputFormat Format,
+                                                 llvm::raw_ostream &OS);
+
+/// Prints Str to OS as a quoted JSON string.
+void printJSONString(llvm::raw_ostream &OS, llvm::StringRef Str);
+
+} // namespace mca
+
+#endif // LLVM_TOOLS_LLVM_MCA_REPORTWRITER_H
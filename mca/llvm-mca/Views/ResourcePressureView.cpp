@@ -21,9 +21,10 @@ namespace mca {
 using namespace llvm;
 
 void ResourcePressureView::initialize() {
-  // Populate the map of resource descriptors.
+  // Populate the table of resource columns.
   unsigned R2VIndex = 0;
   const MCSchedModel &SM = STI.getSchedModel();
+  FirstColumn.resize(SM.getNumProcResourceKinds());
   for (unsigned I = 0, E = SM.getNumProcResourceKinds(); I < E; ++I) {
     const MCProcResourceDesc &ProcResource = *SM.getProcResource(I);
     unsigned NumUnits = ProcResource.NumUnits;
@@ -31,13 +32,12 @@ void ResourcePressureView::initialize() {
     if (ProcResource.SubUnitsIdxBegin || !NumUnits)
       continue;
 
-    Resource2VecIndex.insert(std::pair<unsigned, unsigned>(I, R2VIndex));
+    FirstColumn[I] = R2VIndex;
     R2VIndex += ProcResource.NumUnits;
   }
 
   NumResourceUnits = R2VIndex;
-  ResourceUsage.resize(NumResourceUnits * (Source.size() + 1));
-  std::fill(ResourceUsage.begin(), ResourceUsage.end(), 0.0);
+  ResourceUsage.assign(NumResourceUnits * (Source.size() + 1), 0);
 }
 
 void ResourcePressureView::onEvent(const HWInstructionEvent &Event) {
@@ -46,16 +46,24 @@ void ResourcePressureView::onEvent(const HWInstructionEvent &Event) {
     return;
   const auto &IssueEvent = static_cast<const HWInstructionIssuedEvent &>(Event);
   const unsigned SourceIdx = Event.IR.getSourceIndex() % Source.size();
+  uint64_t *Row = &ResourceUsage[NumResourceUnits * SourceIdx];
+  uint64_t *Totals = &ResourceUsage[NumResourceUnits * Source.size()];
   for (const std::pair<ResourceRef, double> &Use : IssueEvent.UsedResources) {
     const ResourceRef &RR = Use.first;
-    assert(Resource2VecIndex.find(RR.first) != Resource2VecIndex.end());
-    unsigned R2VIndex = Resource2VecIndex[RR.first];
-    R2VIndex += countTrailingZeros(RR.second);
-    ResourceUsage[R2VIndex + NumResourceUnits * SourceIdx] += Use.second;
-    ResourceUsage[R2VIndex + NumResourceUnits * Source.size()] += Use.second;
+    // Units are identified by a mask with a single bit set.
+    unsigned R2VIndex = FirstColumn[RR.first] + countTrailingZeros(RR.second);
+    assert(R2VIndex < NumResourceUnits && "Invalid resource unit!");
+    uint64_t Cycles = static_cast<uint64_t>(Use.second * UsageScale + 0.5);
+    Row[R2VIndex] += Cycles;
+    Totals[R2VIndex] += Cycles;
   }
 }
 
+void ResourcePressureView::onPeriodEnd(unsigned NumRepeats) {
+  for (unsigned I = 0, E = ResourceUsage.size(); I < E; ++I)
+    ResourceUsage[I] += (ResourceUsage[I] - PeriodStartUsage[I]) * NumRepeats;
+}
+
 static void printColumnNames(formatted_raw_ostream &OS,
                              const MCSchedModel &SM) {
   unsigned Column = OS.getColumn();
@@ -126,7 +134,7 @@ void ResourcePressureView::printResourcePressurePerIteration(
   FOS.flush();
 
   for (unsigned I = 0, E = NumResourceUnits; I < E; ++I) {
-    double Usage = ResourceUsage[I + Source.size() * E];
+    double Usage = getUsage(I + Source.size() * E);
     printResourcePressure(FOS, Usage / Executions, (I + 1) * 7);
   }
 
@@ -149,7 +157,7 @@ void ResourcePressureView::printResourcePressurePerInstruction(
 
   for (unsigned I = 0, E = Source.size(); I < E; ++I) {
     for (unsigned J = 0; J < NumResourceUnits; ++J) {
-      double Usage = ResourceUsage[J + I * NumResourceUnits];
+      double Usage = getUsage(J + I * NumResourceUnits);
       printResourcePressure(FOS, Usage / Executions, (J + 1) * 7);
     }
 
@@ -168,4 +176,63 @@ void ResourcePressureView::printResourcePressurePerInstruction(
     Buffer = "";
   }
 }
+
+// Collects the names of the resource units, in the order of the columns of
+// the resource pressure tables. Units of a resource with more than one unit
+// are named <resource>.<unit>.
+static void collectResourceUnitNames(const MCSchedModel &SM,
+                                     SmallVectorImpl<std::string> &Names) {
+  for (unsigned I = 1, E = SM.getNumProcResourceKinds(); I < E; ++I) {
+    const MCProcResourceDesc &ProcResource = *SM.getProcResource(I);
+    unsigned NumUnits = ProcResource.NumUnits;
+    // Skip groups and invalid resources with zero units.
+    if (ProcResource.SubUnitsIdxBegin || !NumUnits)
+      continue;
+
+    for (unsigned J = 0; J < NumUnits; ++J) {
+      std::string Name = ProcResource.Name;
+      if (NumUnits > 1)
+        Name += "." + std::to_string(J);
+      Names.emplace_back(std::move(Name));
+    }
+  }
+}
+
+void ResourcePressureView::writeView(ReportWriter &W) const {
+  SmallVector<std::string, 16> UnitNames;
+  collectResourceUnitNames(STI.getSchedModel(), UnitNames);
+  assert(UnitNames.size() == NumResourceUnits && "Unexpected resource units!");
+  unsigned Executions = Source.getNumIterations();
+
+  W.startTable("Resources");
+  for (unsigned I = 0, E = NumResourceUnits; I < E; ++I) {
+    W.startRow();
+    W.writeString("Name", UnitNames[I]);
+    W.writeNumber("Pressure",
+                  getUsage(I + Source.size() * E) / Executions);
+    W.endRow();
+  }
+  W.endTable();
+
+  std::string Instruction;
+  raw_string_ostream InstrStream(Instruction);
+
+  W.startTable("Instructions");
+  for (unsigned I = 0, E = Source.size(); I < E; ++I) {
+    MCIP.printInst(&Source.getMCInstFromIndex(I), InstrStream, "", STI);
+    InstrStream.flush();
+
+    W.startRow();
+    W.writeString("Instruction", StringRef(Instruction).ltrim());
+    for (unsigned J = 0; J < NumResourceUnits; ++J) {
+      double Usage = getUsage(J + I * NumResourceUnits);
+      // Only report the resources used by the instruction.
+      if (Usage)
+        W.writeNumber(UnitNames[J], Usage / Executions);
+    }
+    W.endRow();
+    Instruction = "";
+  }
+  W.endTable();
+}
 } // namespace mca
@@ -60,10 +60,10 @@
 
 #include "SourceMgr.h"
 #include "Views/View.h"
-#include "llvm/ADT/DenseMap.h"
 #include "llvm/MC/MCInstPrinter.h"
 #include "llvm/MC/MCSubtargetInfo.h"
-#include <map>
+#include <cstdint>
+#include <vector>
 
 namespace mca {
 
@@ -74,13 +74,26 @@ class ResourcePressureView : public View {
   llvm::MCInstPrinter &MCIP;
   const SourceMgr &Source;
 
-  // Map to quickly obtain the ResourceUsage column index from a processor
-  // resource ID.
-  llvm::DenseMap<unsigned, unsigned> Resource2VecIndex;
+  // Column of the first unit of every processor resource, indexed by
+  // processor resource ID. The column of unit U of a resource is the column
+  // of its first unit plus U.
+  std::vector<unsigned> FirstColumn;
 
-  // Table of resources used by instructions.
-  std::vector<double> ResourceUsage;
+  // Table of resources used by instructions. Resource cycles are accumulated
+  // in fixed point, in units of 1/UsageScale cycles: the fractions of cycles
+  // used when a resource group is distributed among up to 16 units are
+  // represented exactly.
+  std::vector<uint64_t> ResourceUsage;
   unsigned NumResourceUnits;
+  static constexpr uint64_t UsageScale = 720720;
+
+  // Snapshot of ResourceUsage taken at the beginning of a steady-state period.
+  std::vector<uint64_t> PeriodStartUsage;
+
+  // Returns the number of cycles accumulated in ResourceUsage[Index].
+  double getUsage(unsigned Index) const {
+    return static_cast<double>(ResourceUsage[Index]) / UsageScale;
+  }
 
   const llvm::MCInst &GetMCInstFromIndex(unsigned Index) const;
   void printResourcePressurePerIteration(llvm::raw_ostream &OS,
@@ -96,13 +109,25 @@ public:
     initialize();
   }
 
+  EventMask getSubscribedEvents() const override {
+    return eventMask(InstructionIssued) | eventMask(PeriodBoundary);
+  }
+
   void onEvent(const HWInstructionEvent &Event) override;
 
+  void onPeriodBegin() override { PeriodStartUsage = ResourceUsage; }
+
+  void onPeriodEnd(unsigned NumRepeats) override;
+
   void printView(llvm::raw_ostream &OS) const override {
     unsigned Executions = Source.getNumIterations();
     printResourcePressurePerIteration(OS, Executions);
     printResourcePressurePerInstruction(OS, Executions);
   }
+
+  llvm::StringRef getName() const override { return "ResourcePressureView"; }
+
+  void writeView(ReportWriter &W) const override;
 };
 } // namespace mca
 
@@ -24,6 +24,19 @@ void RetireControlUnitStatistics::onEvent(const HWInstructionEvent &Event) {
     ++NumRetired;
 }
 
+void RetireControlUnitStatistics::onPeriodBegin() {
+  PeriodStartCycles = NumCycles;
+  PeriodStartRetiredPerCycle = RetiredPerCycle;
+}
+
+void RetireControlUnitStatistics::onPeriodEnd(unsigned NumRepeats) {
+  NumCycles += (NumCycles - PeriodStartCycles) * NumRepeats;
+  for (Histogram::value_type &Entry : RetiredPerCycle) {
+    unsigned Delta = Entry.second - PeriodStartRetiredPerCycle[Entry.first];
+    Entry.second += Delta * NumRepeats;
+  }
+}
+
 void RetireControlUnitStatistics::printView(llvm::raw_ostream &OS) const {
   std::string Buffer;
   raw_string_ostream TempStream(Buffer);
@@ -46,4 +59,16 @@ void RetireControlUnitStatistics::printView(llvm::raw_ostream &OS) const {
   OS << Buffer;
 }
 
+void RetireControlUnitStatistics::writeView(ReportWriter &W) const {
+  W.writeInteger("NumCycles", NumCycles);
+  W.startTable("RetiredPerCycle");
+  for (const std::pair<unsigned, unsigned> &Entry : RetiredPerCycle) {
+    W.startRow();
+    W.writeInteger("NumRetired", Entry.first);
+    W.writeInteger("NumCycles", Entry.second);
+    W.endRow();
+  }
+  W.endTable();
+}
+
 } // namespace mca
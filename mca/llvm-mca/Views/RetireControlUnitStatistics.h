@@ -39,13 +39,24 @@ class RetireControlUnitStatistics : public View {
   unsigned NumRetired;
   unsigned NumCycles;
 
+  // Snapshot of the statistics taken at the beginning of a steady-state
+  // period.
+  Histogram PeriodStartRetiredPerCycle;
+  unsigned PeriodStartCycles;
+
   void updateHistograms() {
     RetiredPerCycle[NumRetired]++;
     NumRetired = 0;
   }
 
 public:
-  RetireControlUnitStatistics() : NumRetired(0), NumCycles(0) {}
+  RetireControlUnitStatistics()
+      : NumRetired(0), NumCycles(0), PeriodStartCycles(0) {}
+
+  EventMask getSubscribedEvents() const override {
+    return eventMask(InstructionRetired) | eventMask(CycleBegin) |
+           eventMask(CycleEnd) | eventMask(PeriodBoundary);
+  }
 
   void onEvent(const HWInstructionEvent &Event) override;
 
@@ -53,7 +64,17 @@ public:
 
   void onCycleEnd() override { updateHistograms(); }
 
+  void onPeriodBegin() override;
+
+  void onPeriodEnd(unsigned NumRepeats) override;
+
   void printView(llvm::raw_ostream &OS) const override;
+
+  llvm::StringRef getName() const override {
+    return "RetireControlUnitStatistics";
+  }
+
+  void writeView(ReportWriter &W) const override;
 };
 } // namespace mca
 
@@ -47,6 +47,26 @@ void SchedulerStatistics::updateHistograms() {
   NumIssued = 0;
 }
 
+void SchedulerStatistics::onPeriodBegin() {
+  PeriodStartCycles = NumCycles;
+  PeriodStartIssuedPerCycle = IssuedPerCycle;
+  PeriodStartUsedSlots.resize(Usage.size());
+  for (unsigned I = 0, E = Usage.size(); I < E; ++I)
+    PeriodStartUsedSlots[I] = Usage[I].CumulativeNumUsedSlots;
+}
+
+void SchedulerStatistics::onPeriodEnd(unsigned NumRepeats) {
+  NumCycles += (NumCycles - PeriodStartCycles) * NumRepeats;
+  for (unsigned I = 0, E = IssuedPerCycle.size(); I < E; ++I) {
+    unsigned Delta = IssuedPerCycle[I] - PeriodStartIssuedPerCycle[I];
+    IssuedPerCycle[I] += Delta * NumRepeats;
+  }
+  for (unsigned I = 0, E = Usage.size(); I < E; ++I) {
+    uint64_t &UsedSlots = Usage[I].CumulativeNumUsedSlots;
+    UsedSlots += (UsedSlots - PeriodStartUsedSlots[I]) * NumRepeats;
+  }
+}
+
 void SchedulerStatistics::printSchedulerStats(raw_ostream &OS) const {
   OS << "\n\nSchedulers - "
      << "number of cycles where we saw N instructions issued:\n";
@@ -126,4 +146,36 @@ void SchedulerStatistics::printView(llvm::raw_ostream &OS) const {
   printSchedulerUsage(OS);
 }
 
+void SchedulerStatistics::writeView(ReportWriter &W) const {
+  W.writeInteger("NumCycles", NumCycles);
+
+  W.startTable("IssuedPerCycle");
+  for (unsigned I = 0, E = IssuedPerCycle.size(); I < E; ++I) {
+    if (!IssuedPerCycle[I])
+      continue;
+    W.startRow();
+    W.writeInteger("NumIssued", I);
+    W.writeInteger("NumCycles", IssuedPerCycle[I]);
+    W.endRow();
+  }
+  W.endTable();
+
+  W.startTable("QueueUsage");
+  for (unsigned I = 0, E = SM.getNumProcResourceKinds(); I < E; ++I) {
+    const MCProcResourceDesc &ProcResource = *SM.getProcResource(I);
+    if (ProcResource.BufferSize <= 0)
+      continue;
+
+    const BufferUsage &BU = Usage[I];
+    W.startRow();
+    W.writeString("Resource", ProcResource.Name);
+    W.writeNumber("AverageUsedSlots",
+                  (double)BU.CumulativeNumUsedSlots / NumCycles);
+    W.writeInteger("MaxUsedSlots", BU.MaxUsedSlots);
+    W.writeInteger("BufferSize", ProcResource.BufferSize);
+    W.endRow();
+  }
+  W.endTable();
+}
+
 } // namespace mca
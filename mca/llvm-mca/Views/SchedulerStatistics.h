@@ -59,6 +59,12 @@ class SchedulerStatistics final : public View {
   std::vector<unsigned> IssuedPerCycle;
   std::vector<BufferUsage> Usage;
 
+  // Snapshot of the statistics taken at the beginning of a steady-state
+  // period.
+  unsigned PeriodStartCycles;
+  std::vector<unsigned> PeriodStartIssuedPerCycle;
+  std::vector<uint64_t> PeriodStartUsedSlots;
+
   void updateHistograms();
   void printSchedulerStats(llvm::raw_ostream &OS) const;
   void printSchedulerUsage(llvm::raw_ostream &OS) const;
@@ -67,7 +73,14 @@ public:
   SchedulerStatistics(const llvm::MCSubtargetInfo &STI)
       : SM(STI.getSchedModel()), NumIssued(0), NumCycles(0),
         IssuedPerCycle(STI.getSchedModel().NumProcResourceKinds, 0),
-        Usage(STI.getSchedModel().NumProcResourceKinds, {0, 0, 0}) {}
+        Usage(STI.getSchedModel().NumProcResourceKinds, {0, 0, 0}),
+        PeriodStartCycles(0) {}
+
+  EventMask getSubscribedEvents() const override {
+    return eventMask(InstructionIssued) | eventMask(CycleBegin) |
+           eventMask(CycleEnd) | eventMask(ReservedBuffers) |
+           eventMask(ReleasedBuffers) | eventMask(PeriodBoundary);
+  }
 
   void onEvent(const HWInstructionEvent &Event) override;
 
@@ -75,6 +88,10 @@ public:
 
   void onCycleEnd() override { updateHistograms(); }
 
+  void onPeriodBegin() override;
+
+  void onPeriodEnd(unsigned NumRepeats) override;
+
   // Increases the number of used scheduler queue slots of every buffered
   // resource in the Buffers set.
   void onReservedBuffers(const InstRef &IR,
@@ -86,6 +103,10 @@ public:
                          llvm::ArrayRef<unsigned> Buffers) override;
 
   void printView(llvm::raw_ostream &OS) const override;
+
+  llvm::StringRef getName() const override { return "SchedulerStatistics"; }
+
+  void writeView(ReportWriter &W) const override;
 };
 } // namespace mca
 
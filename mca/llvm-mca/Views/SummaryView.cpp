@@ -27,7 +27,8 @@ using namespace llvm;
 SummaryView::SummaryView(const llvm::MCSchedModel &Model, const SourceMgr &S,
                          unsigned Width)
     : SM(Model), Source(S), DispatchWidth(Width), TotalCycles(0),
-      NumMicroOps(0), ProcResourceUsage(Model.getNumProcResourceKinds(), 0),
+      PeriodStartCycles(0), NumMicroOps(0),
+      ProcResourceUsage(Model.getNumProcResourceKinds(), 0),
       ProcResourceMasks(Model.getNumProcResourceKinds(), 0) {
   computeProcResourceMasks(SM, ProcResourceMasks);
 }
@@ -39,14 +40,16 @@ void SummaryView::onEvent(const HWInstructionEvent &Event) {
       Event.IR.getSourceIndex() >= Source.size())
     return;
 
+  addBlockInstruction(Event.IR.getInstruction()->getDesc());
+}
+
+void SummaryView::addBlockInstruction(const InstrDesc &Desc) {
   // Update the cumulative number of resource cycles based on the processor
   // resource usage information available from the instruction descriptor. We
   // need to compute the cumulative number of resource cycles for every
   // processor resource which is consumed by an instruction of the block.
-  const Instruction &Inst = *Event.IR.getInstruction();
-  const InstrDesc &Desc = Inst.getDesc();
   NumMicroOps += Desc.NumMicroOps;
-  for (const std::pair<uint64_t, const ResourceUsage> &RU : Desc.Resources) {
+  for (const ResourcePlusCycles &RU : Desc.getResources()) {
     if (RU.second.size()) {
       const auto It = find(ProcResourceMasks, RU.first);
       assert(It != ProcResourceMasks.end() &&
@@ -57,31 +60,51 @@ void SummaryView::onEvent(const HWInstructionEvent &Event) {
   }
 }
 
-void SummaryView::printView(raw_ostream &OS) const {
-  unsigned Iterations = Source.getNumIterations();
-  unsigned Instructions = Source.size();
-  unsigned TotalInstructions = Instructions * Iterations;
-  unsigned TotalUOps = NumMicroOps * Iterations;
-  double IPC = (double)TotalInstructions / TotalCycles;
-  double UOpsPerCycle = (double)TotalUOps / TotalCycles;
-  double BlockRThroughput = computeBlockRThroughput(
+void SummaryView::collectData(DisplayValues &DV) const {
+  DV.Iterations = Source.getNumIterations();
+  DV.TotalInstructions = Source.size() * DV.Iterations;
+  DV.TotalCycles = TotalCycles;
+  DV.DispatchWidth = DispatchWidth;
+  DV.TotalUOps = NumMicroOps * DV.Iterations;
+  DV.IPC = (double)DV.TotalInstructions / TotalCycles;
+  DV.UOpsPerCycle = (double)DV.TotalUOps / TotalCycles;
+  DV.BlockRThroughput = computeBlockRThroughput(
       SM, DispatchWidth, NumMicroOps, ProcResourceUsage);
+}
+
+void SummaryView::printView(raw_ostream &OS) const {
+  DisplayValues DV;
+  collectData(DV);
 
   std::string Buffer;
   raw_string_ostream TempStream(Buffer);
-  TempStream << "Iterations:        " << Iterations;
-  TempStream << "\nInstructions:      " << TotalInstructions;
-  TempStream << "\nTotal Cycles:      " << TotalCycles;
-  TempStream << "\nTotal uOps:        " << TotalUOps << '\n';
-  TempStream << "\nDispatch Width:    " << DispatchWidth;
+  TempStream << "Iterations:        " << DV.Iterations;
+  TempStream << "\nInstructions:      " << DV.TotalInstructions;
+  TempStream << "\nTotal Cycles:      " << DV.TotalCycles;
+  TempStream << "\nTotal uOps:        " << DV.TotalUOps << '\n';
+  TempStream << "\nDispatch Width:    " << DV.DispatchWidth;
   TempStream << "\nuOps Per Cycle:    "
-             << format("%.2f", floor((UOpsPerCycle * 100) + 0.5) / 100);
+             << format("%.2f", floor((DV.UOpsPerCycle * 100) + 0.5) / 100);
   TempStream << "\nIPC:               "
-             << format("%.2f", floor((IPC * 100) + 0.5) / 100);
+             << format("%.2f", floor((DV.IPC * 100) + 0.5) / 100);
   TempStream << "\nBlock RThroughput: "
-             << format("%.1f", floor((BlockRThroughput * 10) + 0.5) / 10)
+             << format("%.1f", floor((DV.BlockRThroughput * 10) + 0.5) / 10)
              << '\n';
   TempStream.flush();
   OS << Buffer;
 }
+
+void SummaryView::writeView(ReportWriter &W) const {
+  DisplayValues DV;
+  collectData(DV);
+
+  W.writeInteger("Iterations", DV.Iterations);
+  W.writeInteger("Instructions", DV.TotalInstructions);
+  W.writeInteger("TotalCycles", DV.TotalCycles);
+  W.writeInteger("TotalUOps", DV.TotalUOps);
+  W.writeInteger("DispatchWidth", DV.DispatchWidth);
+  W.writeNumber("UOpsPerCycle", DV.UOpsPerCycle);
+  W.writeNumber("IPC", DV.IPC);
+  W.writeNumber("BlockRThroughput", DV.BlockRThroughput);
+}
 } // namespace mca.
@@ -43,6 +43,8 @@ class SummaryView : public View {
   const SourceMgr &Source;
   const unsigned DispatchWidth;
   unsigned TotalCycles;
+  // Value of TotalCycles at the beginning of a steady-state period.
+  unsigned PeriodStartCycles;
   // The total number of micro opcodes contributed by a block of instructions.
   unsigned NumMicroOps;
   // For each processor resource, this vector stores the cumulative number of
@@ -61,15 +63,51 @@ class SummaryView : public View {
   //   - Total Resource Cycles / #Units   (for every resource consumed).
   double getBlockRThroughput() const;
 
+  // The performance numbers printed by this view.
+  struct DisplayValues {
+    unsigned Iterations;
+    unsigned TotalInstructions;
+    unsigned TotalCycles;
+    unsigned DispatchWidth;
+    unsigned TotalUOps;
+    double IPC;
+    double UOpsPerCycle;
+    double BlockRThroughput;
+  };
+
+  void collectData(DisplayValues &DV) const;
+
 public:
   SummaryView(const llvm::MCSchedModel &Model, const SourceMgr &S,
               unsigned Width);
 
+  EventMask getSubscribedEvents() const override {
+    return eventMask(InstructionRetired) | eventMask(CycleEnd) |
+           eventMask(PeriodBoundary);
+  }
+
   void onCycleEnd() override { ++TotalCycles; }
 
+  void onPeriodBegin() override { PeriodStartCycles = TotalCycles; }
+
+  void onPeriodEnd(unsigned NumRepeats) override {
+    TotalCycles += (TotalCycles - PeriodStartCycles) * NumRepeats;
+  }
+
   void onEvent(const HWInstructionEvent &Event) override;
 
+  // Accounts for the micro opcodes and the resource cycles of an instruction
+  // of the analyzed block.
+  void addBlockInstruction(const InstrDesc &Desc);
+
+  // Sets the total number of cycles. This allows computing the summary
+  // without observing the simulation, if the view is populated through
+  // method addBlockInstruction().
+  void setTotalCycles(unsigned Cycles) { TotalCycles = Cycles; }
+
   void printView(llvm::raw_ostream &OS) const override;
+  llvm::StringRef getName() const override { return "SummaryView"; }
+  void writeView(ReportWriter &W) const override;
 };
 } // namespace mca
 
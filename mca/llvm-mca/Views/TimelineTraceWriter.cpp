@@ -0,0 +1,159 @@
+//===--------------------- TimelineTraceWriter.cpp --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements the TimelineTraceWriter interface.
+///
+//===----------------------------------------------------------------------===//
+
+#include "Views/TimelineTraceWriter.h"
+#include "Views/ReportWriter.h"
+#include "llvm/Support/Endian.h"
+
+using namespace llvm;
+
+namespace mca {
+
+static void write32(raw_ostream &OS, uint32_t Value) {
+  char Bytes[4];
+  support::endian::write32le(Bytes, Value);
+  OS.write(Bytes, 4);
+}
+
+TimelineTraceWriter::TimelineTraceWriter(const MCSubtargetInfo &STI,
+                                         MCInstPrinter &Printer,
+                                         const SourceMgr &S, StringRef Title,
+                                         TraceFormat F, raw_ostream &Out)
+    : Source(S), Format(F), OS(Out), CurrentCycle(0) {
+  Instructions.reserve(Source.size());
+  for (const std::unique_ptr<const MCInst> &Inst : Source.getSequence()) {
+    std::string Instruction;
+    raw_string_ostream InstrStream(Instruction);
+    Printer.printInst(Inst.get(), InstrStream, "", STI);
+    InstrStream.flush();
+    // Consume any tabs or spaces at the beginning of the string.
+    Instructions.emplace_back(StringRef(Instruction).ltrim());
+  }
+  writeHeader(Title);
+}
+
+void TimelineTraceWriter::writeHeader(StringRef Title) {
+  if (Format == TraceFormat::Binary) {
+    OS << "MCATRACE";
+    write32(OS, BinaryFormatVersion);
+    write32(OS, Instructions.size());
+    for (const std::string &Instruction : Instructions) {
+      write32(OS, Instruction.size());
+      OS << Instruction;
+    }
+    return;
+  }
+
+  OS << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  OS << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,"
+        "\"args\":{\"name\":";
+  printJSONString(OS, Title);
+  OS << "}}";
+}
+
+void TimelineTraceWriter::writeJSONEvent(StringRef Name, char Phase,
+                                         unsigned SourceIndex, unsigned Cycle,
+                                         bool WithPosition) {
+  // The process metadata event is always the first event of the trace.
+  OS << ",\n{\"name\":";
+  printJSONString(OS, Name);
+  OS << ",\"cat\":\"instruction\",\"ph\":\"" << Phase
+     << "\",\"id\":" << SourceIndex << ",\"pid\":0,\"tid\":0,\"ts\":" << Cycle;
+  if (WithPosition) {
+    unsigned Size = Source.size();
+    OS << ",\"args\":{\"iteration\":" << SourceIndex / Size
+       << ",\"index\":" << SourceIndex % Size << '}';
+  }
+  OS << '}';
+}
+
+void TimelineTraceWriter::writeJSONSlice(StringRef Name, unsigned SourceIndex,
+                                         unsigned Begin, unsigned End) {
+  // Empty slices are not displayed by trace viewers.
+  if (Begin == End)
+    return;
+  writeJSONEvent(Name, 'b', SourceIndex, Begin);
+  writeJSONEvent(Name, 'e', SourceIndex, End);
+}
+
+void TimelineTraceWriter::writeJSONRecord(unsigned SourceIndex,
+                                          const InFlightEntry &E,
+                                          unsigned CycleRetired) {
+  StringRef Name = Instructions[SourceIndex % Source.size()];
+  // The instruction slice extends to the end of its retire cycle, so that it
+  // is never empty.
+  writeJSONEvent(Name, 'b', SourceIndex, E.CycleDispatched,
+                 /* WithPosition */ true);
+  writeJSONSlice("Waiting", SourceIndex, E.CycleDispatched, E.CycleReady);
+  writeJSONSlice("Ready", SourceIndex, E.CycleReady, E.CycleIssued);
+  writeJSONSlice("Executing", SourceIndex, E.CycleIssued, E.CycleExecuted);
+  writeJSONSlice("Retiring", SourceIndex, E.CycleExecuted, CycleRetired);
+  writeJSONEvent(Name, 'e', SourceIndex, CycleRetired + 1);
+}
+
+void TimelineTraceWriter::writeBinaryRecord(unsigned SourceIndex,
+                                            const InFlightEntry &E,
+                                            unsigned CycleRetired) {
+  write32(OS, SourceIndex);
+  write32(OS, E.CycleDispatched);
+  write32(OS, E.CycleReady);
+  write32(OS, E.CycleIssued);
+  write32(OS, E.CycleExecuted);
+  write32(OS, CycleRetired);
+}
+
+void TimelineTraceWriter::onEvent(const HWInstructionEvent &Event) {
+  const unsigned Index = Event.IR.getSourceIndex();
+
+  switch (Event.Type) {
+  case HWInstructionEvent::Dispatched:
+    // There may be multiple dispatch events. Microcoded instructions that are
+    // expanded into multiple uOps may require multiple dispatch cycles. Here,
+    // we want to capture the first dispatch cycle.
+    InFlight.insert(std::make_pair(
+        Index, InFlightEntry{CurrentCycle, CurrentCycle, CurrentCycle,
+                             CurrentCycle}));
+    break;
+  case HWInstructionEvent::Ready:
+    InFlight[Index].CycleReady = CurrentCycle;
+    break;
+  case HWInstructionEvent::Issued:
+    InFlight[Index].CycleIssued = CurrentCycle;
+    break;
+  case HWInstructionEvent::Executed:
+    InFlight[Index].CycleExecuted = CurrentCycle;
+    break;
+  case HWInstructionEvent::Retired: {
+    auto It = InFlight.find(Index);
+    assert(It != InFlight.end() && "Retired an instruction never dispatched!");
+    if (Format == TraceFormat::Binary)
+      writeBinaryRecord(Index, It->second, CurrentCycle);
+    else
+      writeJSONRecord(Index, It->second, CurrentCycle);
+    InFlight.erase(It);
+    break;
+  }
+  default:
+    return;
+  }
+}
+
+void TimelineTraceWriter::finish() {
+  assert(InFlight.empty() && "Unexpected instructions in flight!");
+  if (Format == TraceFormat::JSON)
+    OS << "\n]}\n";
+  OS.flush();
+}
+
+} // namespace mca
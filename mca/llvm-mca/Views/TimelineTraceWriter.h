@@ -0,0 +1,112 @@
+//===--------------------- TimelineTraceWriter.h ----------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file defines class TimelineTraceWriter, an event listener that
+/// streams the timeline of every simulated instruction to a trace file.
+///
+/// Unlike the TimelineView, this listener doesn't record the timeline. The
+/// state transition cycles of an instruction are only kept while the
+/// instruction is in flight, and they are written to the trace as soon as the
+/// instruction retires. Memory usage is bounded by the number of
+/// instructions in flight, and doesn't depend on the number of simulated
+/// cycles.
+///
+/// Two trace formats are supported:
+///
+///  - JSON: the Chrome trace event format, which can be opened by
+///    chrome://tracing and by Perfetto. Every instruction is an async slice
+///    identified by its source index, with nested slices for the cycles it
+///    spends waiting for its operands, waiting for a pipeline, executing, and
+///    waiting to retire. One cycle is displayed as one microsecond.
+///
+///  - Binary: a header followed by one fixed size record per retired
+///    instruction. All fields are little-endian:
+///
+///      Header:  "MCATRACE", format version (uint32), number of instructions
+///               in the sequence (uint32), and for every instruction of the
+///               sequence, the length (uint32) and the text of the
+///               instruction.
+///      Record:  source index, and the cycles in which the instruction was
+///               dispatched, ready, issued, executed and retired (uint32).
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCA_TIMELINETRACEWRITER_H
+#define LLVM_TOOLS_LLVM_MCA_TIMELINETRACEWRITER_H
+
+#include "HWEventListener.h"
+#include "SourceMgr.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/MC/MCInstPrinter.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+#include <vector>
+
+namespace mca {
+
+enum class TraceFormat { JSON, Binary };
+
+class TimelineTraceWriter : public HWEventListener {
+  const SourceMgr &Source;
+  TraceFormat Format;
+  llvm::raw_ostream &OS;
+
+  unsigned CurrentCycle;
+
+  struct InFlightEntry {
+    unsigned CycleDispatched;
+    unsigned CycleReady;
+    unsigned CycleIssued;
+    unsigned CycleExecuted;
+  };
+  // Instructions dispatched and not retired yet, indexed by source index.
+  llvm::DenseMap<unsigned, InFlightEntry> InFlight;
+
+  // The text of every instruction of the sequence.
+  std::vector<std::string> Instructions;
+
+  static const unsigned BinaryFormatVersion = 1;
+
+  void writeHeader(llvm::StringRef Title);
+  void writeJSONEvent(llvm::StringRef Name, char Phase, unsigned SourceIndex,
+                      unsigned Cycle, bool WithPosition = false);
+  void writeJSONSlice(llvm::StringRef Name, unsigned SourceIndex,
+                      unsigned Begin, unsigned End);
+  void writeJSONRecord(unsigned SourceIndex, const InFlightEntry &E,
+                       unsigned CycleRetired);
+  void writeBinaryRecord(unsigned SourceIndex, const InFlightEntry &E,
+                         unsigned CycleRetired);
+
+public:
+  TimelineTraceWriter(const llvm::MCSubtargetInfo &STI,
+                      llvm::MCInstPrinter &Printer, const SourceMgr &Sequence,
+                      llvm::StringRef Title, TraceFormat Format,
+                      llvm::raw_ostream &OS);
+
+  // Event handlers.
+  EventMask getSubscribedEvents() const override {
+    return eventMask(InstructionRetired) | eventMask(InstructionReady) |
+           eventMask(InstructionIssued) | eventMask(InstructionExecuted) |
+           eventMask(InstructionDispatched) | eventMask(CycleEnd);
+  }
+
+  void onCycleEnd() override { ++CurrentCycle; }
+  void onEvent(const HWInstructionEvent &Event) override;
+
+  llvm::StringRef getName() const override { return "TimelineTraceWriter"; }
+
+  // Completes the trace. It must be called once the simulation has ended.
+  void finish();
+};
+} // namespace mca
+
+#endif // LLVM_TOOLS_LLVM_MCA_TIMELINETRACEWRITER_H
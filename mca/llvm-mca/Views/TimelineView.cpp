@@ -287,4 +287,56 @@ void TimelineView::printTimeline(raw_ostream &OS) const {
     Instruction = "";
   }
 }
+
+void TimelineView::writeView(ReportWriter &W) const {
+  std::string Instruction;
+  raw_string_ostream InstrStream(Instruction);
+
+  W.startTable("Timeline");
+  for (unsigned I = 0, E = Timeline.size(); I < E; ++I) {
+    const TimelineViewEntry &Entry = Timeline[I];
+    if (Entry.CycleRetired == 0)
+      break;
+
+    const MCInst &Inst = AsmSequence.getMCInstFromIndex(I);
+    MCIP.printInst(&Inst, InstrStream, "", STI);
+    InstrStream.flush();
+
+    W.startRow();
+    W.writeInteger("Iteration", I / AsmSequence.size());
+    W.writeInteger("Index", I % AsmSequence.size());
+    W.writeString("Instruction", StringRef(Instruction).ltrim());
+    W.writeInteger("CycleDispatched", Entry.CycleDispatched);
+    W.writeInteger("CycleReady", Entry.CycleReady);
+    W.writeInteger("CycleIssued", Entry.CycleIssued);
+    W.writeInteger("CycleExecuted", Entry.CycleExecuted);
+    W.writeInteger("CycleRetired", Entry.CycleRetired);
+    W.endRow();
+    Instruction = "";
+  }
+  W.endTable();
+
+  W.startTable("AverageWaitTimes");
+  unsigned Executions = Timeline.size() / AsmSequence.size();
+  for (unsigned I = 0, E = WaitTime.size(); I < E; ++I) {
+    const WaitTimeEntry &Entry = WaitTime[I];
+    const MCInst &Inst = AsmSequence.getMCInstFromIndex(I);
+    MCIP.printInst(&Inst, InstrStream, "", STI);
+    InstrStream.flush();
+
+    W.startRow();
+    W.writeInteger("Index", I);
+    W.writeString("Instruction", StringRef(Instruction).ltrim());
+    W.writeInteger("Executions", Executions);
+    W.writeNumber("SchedulerQueue",
+                  (double)Entry.CyclesSpentInSchedulerQueue / Executions);
+    W.writeNumber("SchedulerQueueWhileReady",
+                  (double)Entry.CyclesSpentInSQWhileReady / Executions);
+    W.writeNumber("WriteBackToRetire",
+                  (double)Entry.CyclesSpentAfterWBAndBeforeRetire / Executions);
+    W.endRow();
+    Instruction = "";
+  }
+  W.endTable();
+}
 } // namespace mca
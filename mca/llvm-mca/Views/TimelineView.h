@@ -170,6 +170,13 @@ public:
                unsigned Cycles);
 
   // Event handlers.
+  EventMask getSubscribedEvents() const override {
+    return eventMask(InstructionRetired) | eventMask(InstructionReady) |
+           eventMask(InstructionIssued) | eventMask(InstructionExecuted) |
+           eventMask(InstructionDispatched) | eventMask(CycleEnd) |
+           eventMask(ReservedBuffers);
+  }
+
   void onCycleEnd() override { ++CurrentCycle; }
   void onEvent(const HWInstructionEvent &Event) override;
   void onReservedBuffers(const InstRef &IR,
@@ -182,6 +189,10 @@ public:
     printTimeline(OS);
     printAverageWaitTimes(OS);
   }
+
+  llvm::StringRef getName() const override { return "TimelineView"; }
+
+  void writeView(ReportWriter &W) const override;
 };
 } // namespace mca
 
@@ -17,6 +17,8 @@
 #define LLVM_TOOLS_LLVM_MCA_VIEW_H
 
 #include "HWEventListener.h"
+#include "Views/ReportWriter.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/Support/raw_ostream.h"
 
 namespace mca {
@@ -24,6 +26,10 @@ namespace mca {
 class View : public HWEventListener {
 public:
   virtual void printView(llvm::raw_ostream &OS) const = 0;
+  // Returns the name of the section of this view in a structured report.
+  llvm::StringRef getName() const override = 0;
+  // Writes the content of this view to a structured report.
+  virtual void writeView(ReportWriter &W) const = 0;
   virtual ~View() = default;
   void anchor() override;
 };
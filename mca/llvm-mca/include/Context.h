@@ -32,14 +32,18 @@ namespace mca {
 /// the pre-built "default" out-of-order pipeline.
 struct PipelineOptions {
   PipelineOptions(unsigned DW, unsigned RFS, unsigned LQS, unsigned SQS,
-                  bool NoAlias)
+                  bool NoAlias, bool SkipIdle = false,
+                  bool Extrapolate = false)
       : DispatchWidth(DW), RegisterFileSize(RFS), LoadQueueSize(LQS),
-        StoreQueueSize(SQS), AssumeNoAlias(NoAlias) {}
+        StoreQueueSize(SQS), AssumeNoAlias(NoAlias), SkipIdleCycles(SkipIdle),
+        ExtrapolateSteadyState(Extrapolate) {}
   unsigned DispatchWidth;
   unsigned RegisterFileSize;
   unsigned LoadQueueSize;
   unsigned StoreQueueSize;
   bool AssumeNoAlias;
+  bool SkipIdleCycles;
+  bool ExtrapolateSteadyState;
 };
 
 class Context {
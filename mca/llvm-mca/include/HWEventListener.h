@@ -17,6 +17,9 @@
 
 #include "Instruction.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
 #include <utility>
 
 namespace mca {
@@ -127,6 +130,60 @@ public:
 
 class HWEventListener {
 public:
+  // The kinds of event that a listener can subscribe to. Instruction events
+  // are split by generic event type, so that listeners only interested in a
+  // few instruction state changes are not invoked for every other one.
+  enum EventKind : unsigned {
+    InstructionRetired,
+    InstructionReady,
+    InstructionIssued,
+    InstructionExecuted,
+    InstructionDispatched,
+    // Instruction events of a subtarget-specific type.
+    InstructionOther,
+    Stall,
+    CycleBegin,
+    CycleEnd,
+    ResourceAvailable,
+    ReservedBuffers,
+    ReleasedBuffers,
+    // Both onPeriodBegin() and onPeriodEnd().
+    PeriodBoundary,
+    NumEventKinds
+  };
+
+  using EventMask = unsigned;
+  static constexpr EventMask eventMask(EventKind Kind) { return 1U << Kind; }
+  static constexpr EventMask AllEvents = (1U << NumEventKinds) - 1;
+
+  static EventKind getEventKind(const HWInstructionEvent &Event) {
+    switch (Event.Type) {
+    case HWInstructionEvent::Retired:
+      return InstructionRetired;
+    case HWInstructionEvent::Ready:
+      return InstructionReady;
+    case HWInstructionEvent::Issued:
+      return InstructionIssued;
+    case HWInstructionEvent::Executed:
+      return InstructionExecuted;
+    case HWInstructionEvent::Dispatched:
+      return InstructionDispatched;
+    default:
+      return InstructionOther;
+    }
+  }
+  static EventKind getEventKind(const HWStallEvent &Event) { return Stall; }
+
+  // Returns the set of event kinds this listener wants to be notified of.
+  // Callbacks for any other kind of event are never invoked, and producers
+  // skip building the payload of events that nobody subscribed to. The mask
+  // is read once, when the listener is registered with the pipeline.
+  virtual EventMask getSubscribedEvents() const { return AllEvents; }
+
+  // Returns the name of this listener, which is used to report the time spent
+  // in its callbacks (see class PipelineProfiler).
+  virtual llvm::StringRef getName() const { return "HWEventListener"; }
+
   // Generic events generated by the pipeline.
   virtual void onCycleBegin() {}
   virtual void onCycleEnd() {}
@@ -144,11 +201,48 @@ public:
   virtual void onReleasedBuffers(const InstRef &Inst,
                                  llvm::ArrayRef<unsigned> Buffers) {}
 
+  // Events generated by the pipeline when steady-state extrapolation is
+  // enabled. A period begins when the pipeline suspects that the simulation
+  // has become periodic. If that is confirmed at the end of the period, every
+  // event observed during the period is expected to repeat NumRepeats more
+  // times, and those repetitions are not simulated. Listeners that accumulate
+  // statistics must take a snapshot at the beginning of a period, and
+  // extrapolate their statistics at the end of it. A period may begin again
+  // before ending, in which case the previous snapshot is discarded.
+  virtual void onPeriodBegin() {}
+  virtual void onPeriodEnd(unsigned NumRepeats) {}
+
   virtual ~HWEventListener() {}
 
 private:
   virtual void anchor();
 };
+
+// A table of listeners indexed by event kind. Event producers iterate over
+// the listeners subscribed to a specific kind of event.
+class HWEventListenerTable {
+  llvm::SmallVector<HWEventListener *, 4>
+      Listeners[HWEventListener::NumEventKinds];
+
+public:
+  void add(HWEventListener *Listener) {
+    HWEventListener::EventMask Mask = Listener->getSubscribedEvents();
+    for (unsigned Kind = 0; Kind < HWEventListener::NumEventKinds; ++Kind) {
+      auto &List = Listeners[Kind];
+      if ((Mask & (1U << Kind)) && !llvm::is_contained(List, Listener))
+        List.push_back(Listener);
+    }
+  }
+
+  llvm::ArrayRef<HWEventListener *>
+  get(HWEventListener::EventKind Kind) const {
+    return Listeners[Kind];
+  }
+
+  bool has(HWEventListener::EventKind Kind) const {
+    return !Listeners[Kind].empty();
+  }
+};
 } // namespace mca
 
 #endif
@@ -17,13 +17,63 @@
 #define LLVM_TOOLS_LLVM_MCA_LSUNIT_H
 
 #include "HardwareUnits/HardwareUnit.h"
-#include <set>
+#include "llvm/ADT/SmallVector.h"
+#include <cstdint>
 
 namespace mca {
 
 class InstRef;
+class StateSignature;
 struct InstrDesc;
 
+/// An age-ordered queue of memory operations.
+///
+/// Entries are source indices, and they are inserted in program order.
+/// Membership is tracked by a circular bitset that spans the source indices
+/// between the oldest and the youngest entry. That span is bounded by the
+/// number of instructions in flight, so insertions, removals, and queries on
+/// the oldest entry are all O(1). Removing the oldest entry has to search for
+/// the next one, which is amortized over the removed entries.
+class MemoryQueue {
+  // Bit (Index % Capacity) is set if Index is in the queue. The number of
+  // words is always a power of two.
+  llvm::SmallVector<uint64_t, 4> Bits;
+  unsigned Oldest;
+  unsigned Youngest;
+  unsigned NumEntries;
+
+  unsigned getCapacity() const { return Bits.size() * 64; }
+  uint64_t &getWord(unsigned Index) {
+    return Bits[(Index / 64) & (Bits.size() - 1)];
+  }
+  bool test(unsigned Index) const {
+    return (Bits[(Index / 64) & (Bits.size() - 1)] >> (Index % 64)) & 1;
+  }
+
+  // Grows the bitset so that it can track at least MinCapacity indices.
+  void grow(unsigned MinCapacity);
+
+public:
+  MemoryQueue() : Bits(1), Oldest(0), Youngest(0), NumEntries(0) {}
+
+  bool empty() const { return !NumEntries; }
+  unsigned size() const { return NumEntries; }
+  // Returns the source index of the oldest entry in the queue.
+  unsigned front() const {
+    assert(!empty() && "Empty queue!");
+    return Oldest;
+  }
+  unsigned count(unsigned Index) const {
+    return !empty() && Index >= Oldest && Index <= Youngest && test(Index);
+  }
+
+  void insert(unsigned Index);
+  void erase(unsigned Index);
+
+  // Appends the entries of this queue to S, from the oldest to the youngest.
+  void encodeState(StateSignature &S) const;
+};
+
 /// A Load/Store Unit implementing a load and store queues.
 ///
 /// This class implements a load queue and a store queue to emulate the
@@ -99,8 +149,8 @@ class LSUnit : public HardwareUnit {
   // If true, loads will never alias with stores. This is the default.
   bool NoAlias;
 
-  std::set<unsigned> LoadQueue;
-  std::set<unsigned> StoreQueue;
+  MemoryQueue LoadQueue;
+  MemoryQueue StoreQueue;
 
   void assignLQSlot(unsigned Index);
   void assignSQSlot(unsigned Index);
@@ -109,12 +159,12 @@ class LSUnit : public HardwareUnit {
   // An instruction that both 'mayStore' and 'HasUnmodeledSideEffects' is
   // conservatively treated as a store barrier. It forces older store to be
   // executed before newer stores are issued.
-  std::set<unsigned> StoreBarriers;
+  MemoryQueue StoreBarriers;
 
   // An instruction that both 'MayLoad' and 'HasUnmodeledSideEffects' is
   // conservatively treated as a load barrier. It forces older loads to execute
   // before newer loads are issued.
-  std::set<unsigned> LoadBarriers;
+  MemoryQueue LoadBarriers;
 
   bool isSQEmpty() const { return StoreQueue.empty(); }
   bool isLQEmpty() const { return LoadQueue.empty(); }
@@ -154,6 +204,8 @@ public:
   // 6. A store has to wait until an older store barrier is fully executed.
   virtual bool isReady(const InstRef &IR) const;
   void onInstructionExecuted(const InstRef &IR);
+
+  void encodeState(StateSignature &S) const;
 };
 
 } // namespace mca
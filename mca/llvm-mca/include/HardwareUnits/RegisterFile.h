@@ -26,6 +26,7 @@
 namespace mca {
 
 class ReadState;
+class StateSignature;
 class WriteState;
 class WriteRef;
 
@@ -95,6 +96,32 @@ class RegisterFile : public HardwareUnit {
   // This map contains one entry for each register defined by the target.
   std::vector<RegisterMapping> RegisterMappings;
 
+  // The sub-registers (or the super-registers) of every register defined by
+  // the target, flattened in a single vector. They are computed once, so that
+  // register renaming never walks the register info tables.
+  class RegisterAliasTable {
+    std::vector<llvm::MCPhysReg> Aliases;
+    // Aliases of register R are in Aliases[Begin[R] .. Begin[R + 1]).
+    std::vector<unsigned> Begin;
+
+  public:
+    template <typename IteratorT>
+    void initialize(const llvm::MCRegisterInfo &MRI);
+
+    llvm::ArrayRef<llvm::MCPhysReg> get(unsigned RegID) const {
+      return llvm::makeArrayRef(Aliases.data() + Begin[RegID],
+                                Aliases.data() + Begin[RegID + 1]);
+    }
+  };
+  RegisterAliasTable SubRegs;
+  RegisterAliasTable SuperRegs;
+
+  // The generation of the last collectWrites() query.
+  mutable uint64_t CollectGeneration;
+
+  // Incremented every time physical registers are allocated or released.
+  unsigned PhysRegsGeneration;
+
   // This method creates a new register file descriptor.
   // The new register file owns all of the registers declared by register
   // classes in the 'RegisterClasses' set.
@@ -147,7 +174,15 @@ public:
                            llvm::MutableArrayRef<unsigned> FreedPhysRegs,
                            bool ShouldFreePhysRegs = true);
 
-  // Checks if there are enough physical registers in the register files.
+  // Computes how many physical registers must be allocated in each register
+  // file to rename the registers in Regs. NumPhysRegs must have one element
+  // per register file, and it must be zero-initialized.
+  void getRegisterCosts(llvm::ArrayRef<unsigned> Regs,
+                        llvm::MutableArrayRef<unsigned> NumPhysRegs) const;
+
+  // Checks if there are enough physical registers in the register files to
+  // allocate NumPhysRegs[I] registers in every register file I (see method
+  // getRegisterCosts()).
   // Returns a "response mask" where each bit represents the response from a
   // different register file.  A mask of all zeroes means that all register
   // files are available.  Otherwise, the mask can be used to identify which
@@ -156,11 +191,23 @@ public:
   //
   // Current implementation can simulate up to 32 register files (including the
   // special register file at index #0).
-  unsigned isAvailable(llvm::ArrayRef<unsigned> Regs) const;
+  unsigned isAvailable(llvm::ArrayRef<unsigned> NumPhysRegs) const;
+
+  // Returns a value that changes every time physical registers are allocated
+  // or released. The outcome of isAvailable() can only change when this value
+  // changes.
+  unsigned getPhysRegsGeneration() const { return PhysRegsGeneration; }
+
+  // Appends to Writes the writes in flight of register RegID and of its
+  // sub-registers. Every write is appended at most once.
   void collectWrites(llvm::SmallVectorImpl<WriteRef> &Writes,
                      unsigned RegID) const;
   unsigned getNumRegisterFiles() const { return RegisterFiles.size(); }
 
+  // Appends the register mappings and the number of physical registers in use
+  // to S.
+  void encodeState(StateSignature &S) const;
+
 #ifndef NDEBUG
   void dump() const;
 #endif
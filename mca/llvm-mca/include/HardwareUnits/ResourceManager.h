@@ -24,6 +24,8 @@
 
 namespace mca {
 
+class StateSignature;
+
 /// Used to notify the internal state of a processor resource.
 ///
 /// A processor resource is available if it is not reserved, and there are
@@ -61,6 +63,11 @@ public:
   ///
   /// The default strategy uses this information to bias its selection logic.
   virtual void used(uint64_t ResourceMask) {}
+
+  /// Appends the internal state of this strategy to S (see class
+  /// StateSignature). Strategies with internal state must override this
+  /// method, otherwise steady-state extrapolation may be inaccurate.
+  virtual void encodeState(StateSignature &S) const {}
 };
 
 /// Default resource allocation strategy used by processor resource groups and
@@ -127,6 +134,7 @@ public:
 
   uint64_t select(uint64_t ReadyMask) override;
   void used(uint64_t Mask) override;
+  void encodeState(StateSignature &S) const override;
 };
 
 /// A processor resource descriptor.
@@ -240,6 +248,8 @@ public:
   /// Returns RS_BUFFER_UNAVAILABLE if there are no available slots.
   ResourceStateEvent isBufferAvailable() const;
 
+  void encodeState(StateSignature &S) const;
+
   /// Reserve a slot in the buffer.
   void reserveBuffer() {
     if (AvailableSlots)
@@ -282,13 +292,34 @@ class ResourceManager {
   std::vector<std::unique_ptr<ResourceState>> Resources;
   std::vector<std::unique_ptr<ResourceStrategy>> Strategies;
 
-  // Keeps track of which resources are busy, and how many cycles are left
-  // before those become usable again.
+  // Number of cycle events observed by this resource manager.
+  unsigned CurrentCycle;
+
+  // Keeps track of which resources are busy, and the cycle in which those
+  // become usable again.
   llvm::SmallDenseMap<ResourceRef, unsigned> BusyResources;
 
+  // A timing wheel used to release busy resources.
+  //
+  // A resource released at cycle C is stored in slot (C % TimingWheelSize).
+  // On every cycle, only the resources of the current slot are visited.
+  // Resources that are busy for more than TimingWheelSize cycles stay in their
+  // slot until the wheel completes enough rotations.
+  static constexpr unsigned TimingWheelSize = 32;
+  llvm::SmallVector<llvm::SmallVector<ResourceRef, 4>, TimingWheelSize>
+      TimingWheel;
+
+  // Marks resource RR as busy for the next NumCycles cycles.
+  void setBusy(const ResourceRef &RR, unsigned NumCycles);
+
   // A table to map processor resource IDs to processor resource masks.
   llvm::SmallVector<uint64_t, 8> ProcResID2Mask;
 
+  // Maps the index of a processor resource (see field Resources) to the indices
+  // of the resource groups that contain it. Only non-group resources have
+  // entries in this table.
+  std::vector<llvm::SmallVector<unsigned, 4>> Resource2Groups;
+
   // Returns the actual resource unit that will be used.
   ResourceRef selectPipe(uint64_t ResourceID);
 
@@ -342,12 +373,33 @@ public:
 
   bool canBeIssued(const InstrDesc &Desc) const;
 
+  // Consumes the resources of an instruction. If Pipes is not null, it is
+  // populated with the resource units selected, and the number of cycles
+  // they are used for.
   void issueInstruction(
       const InstrDesc &Desc,
-      llvm::SmallVectorImpl<std::pair<ResourceRef, double>> &Pipes);
+      llvm::SmallVectorImpl<std::pair<ResourceRef, double>> *Pipes);
 
   void cycleEvent(llvm::SmallVectorImpl<ResourceRef> &ResourcesFreed);
 
+  unsigned getCurrentCycle() const { return CurrentCycle; }
+
+  // Returns the earliest cycle in which a busy resource is released. Returns
+  // UNBOUNDED_IDLE_CYCLES if no resources are busy.
+  unsigned getNextReleaseCycle() const;
+
+  // Returns the number of cycles before the next busy resource is released,
+  // minus one. Returns UNBOUNDED_IDLE_CYCLES if no resources are busy.
+  unsigned getNumIdleCycles() const;
+
+  // Advances the state of busy resources by NumCycles cycles. NumCycles must
+  // not exceed the value returned by getNumIdleCycles().
+  void skipCycles(unsigned NumCycles);
+
+  // Appends the state of every processor resource to S. The release cycles of
+  // busy resources are encoded relative to the current cycle.
+  void encodeState(StateSignature &S) const;
+
 #ifndef NDEBUG
   void dump() const {
     for (const std::unique_ptr<ResourceState> &Resource : Resources)
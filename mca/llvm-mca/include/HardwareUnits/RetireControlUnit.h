@@ -22,6 +22,8 @@
 
 namespace mca {
 
+class StateSignature;
+
 /// This class tracks which instructions are in-flight (i.e., dispatched but not
 /// retired) in the OoO backend.
 //
@@ -87,6 +89,11 @@ public:
   // Update the RCU token to represent the executed state.
   void onInstructionExecuted(unsigned TokenID);
 
+  // Appends the tokens in the queue to S, starting from the oldest one. Token
+  // IDs are not encoded, since the queue behaves the same regardless of the
+  // position of its first token.
+  void encodeState(StateSignature &S) const;
+
 #ifndef NDEBUG
   void dump() const;
 #endif
@@ -17,9 +17,14 @@
 
 #include "HardwareUnits/HardwareUnit.h"
 #include "HardwareUnits/LSUnit.h"
+#include "PipelineProfiler.h"
 #include "ResourceManager.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/MC/MCSchedule.h"
+#include <functional>
+#include <queue>
+#include <set>
 
 namespace mca {
 
@@ -28,34 +33,27 @@ public:
   SchedulerStrategy() = default;
   virtual ~SchedulerStrategy();
 
-  /// Returns true if Lhs should take priority over Rhs.
+  /// Returns the rank of a ready instruction. The lower the rank value, the
+  /// better. Instructions with the same rank are selected in program order.
   ///
   /// This method is used by class Scheduler to select the "best" ready
-  /// instruction to issue to the underlying pipelines.
-  virtual bool compare(const InstRef &Lhs, const InstRef &Rhs) const = 0;
+  /// instruction to issue to the underlying pipelines. Ready instructions are
+  /// kept sorted by rank. A rank is only recomputed when the instruction
+  /// becomes ready, and when new users of its register definitions are
+  /// dispatched.
+  virtual int computeRank(const InstRef &IR) const = 0;
 };
 
 /// Default instruction selection strategy used by class Scheduler.
 class DefaultSchedulerStrategy : public SchedulerStrategy {
-  /// This method ranks instructions based on their age, and the number of known
-  /// users. The lower the rank value, the better.
-  int computeRank(const InstRef &Lhs) const {
-    return Lhs.getSourceIndex() - Lhs.getInstruction()->getNumUsers();
-  }
-
 public:
   DefaultSchedulerStrategy() = default;
   virtual ~DefaultSchedulerStrategy();
 
-  bool compare(const InstRef &Lhs, const InstRef &Rhs) const override {
-    int LhsRank = computeRank(Lhs);
-    int RhsRank = computeRank(Rhs);
-
-    /// Prioritize older instructions over younger instructions to minimize the
-    /// pressure on the reorder buffer.
-    if (LhsRank == RhsRank)
-      return Lhs.getSourceIndex() < Rhs.getSourceIndex();
-    return LhsRank < RhsRank;
+  /// This method ranks instructions based on their age, and the number of known
+  /// users.
+  int computeRank(const InstRef &IR) const override {
+    return IR.getSourceIndex() - IR.getInstruction()->getNumUsers();
   }
 };
 
@@ -75,8 +73,16 @@ public:
 /// Instructions that are moved from the WaitSet to the ReadySet transition
 /// in state from 'IS_AVAILABLE' to 'IS_READY'.
 ///
-/// On every cycle, the Scheduler checks if it can promote instructions from the
-/// WaitSet to the ReadySet.
+/// Instructions in the WaitSet are not updated on every cycle. Instead, the
+/// Scheduler tracks the events that can make a waiting instruction ready:
+///  - Instructions that depend on register writes which have not been issued
+///    yet are woken up when one of those writes is issued.
+///  - Instructions whose operands become available at a known cycle are
+///    queued in a wakeup queue ordered by cycle.
+///  - Instructions with ready operands that are blocked by the LSUnit are
+///    checked on every cycle.
+/// The internal state of a waiting instruction is only brought up to date when
+/// it is woken up. Instructions with nothing resolved are never touched.
 ///
 /// An Instruction is moved from the ReadySet the `IssuedSet` when it is issued
 /// to a (one or more) pipeline(s). This event also causes an instruction state
@@ -91,8 +97,72 @@ class Scheduler : public HardwareUnit {
   // Hardware resources that are managed by this scheduler.
   std::unique_ptr<ResourceManager> Resources;
 
-  std::vector<InstRef> WaitSet;
-  std::vector<InstRef> ReadySet;
+  // Number of cycle events observed by this scheduler.
+  unsigned CurrentCycle;
+
+  // Counters of the entries scanned by this scheduler. Null unless profiling
+  // is enabled.
+  PipelineProfiler::SchedulerCounters *ScanCounters;
+
+  // An instruction in the WaitSet. Field LastUpdateCycle is the last cycle in
+  // which the state of the instruction has been updated.
+  struct WaitEntry {
+    InstRef IR;
+    unsigned LastUpdateCycle;
+  };
+
+  // Waiting instructions, indexed by source index.
+  llvm::DenseMap<unsigned, WaitEntry> WaitSet;
+
+  // Maps unresolved register reads to the source index of the instruction
+  // that owns them.
+  llvm::DenseMap<const ReadState *, unsigned> ReadUsers;
+
+  // Maps register writes to the source index of instructions that perform a
+  // partial register update on top of them.
+  llvm::DenseMap<const WriteState *, llvm::SmallVector<unsigned, 1>> WriteUsers;
+
+  // A min-heap of <cycle, source index> pairs. Each pair identifies the cycle
+  // in which an instruction from the WaitSet is expected to become ready.
+  using WakeupEntry = std::pair<unsigned, unsigned>;
+  std::priority_queue<WakeupEntry, std::vector<WakeupEntry>,
+                      std::greater<WakeupEntry>>
+      WakeupQueue;
+
+  // Instructions from the WaitSet whose register operands are ready. These
+  // are moved to the ReadySet as soon as memory dependencies are met.
+  std::vector<InstRef> PendingSet;
+
+  // A ready instruction, and its rank.
+  struct ReadyEntry {
+    int Rank;
+    InstRef IR;
+
+    // Prioritize older instructions over younger instructions to minimize the
+    // pressure on the reorder buffer.
+    bool operator<(const ReadyEntry &Other) const {
+      if (Rank == Other.Rank)
+        return IR.getSourceIndex() < Other.IR.getSourceIndex();
+      return Rank < Other.Rank;
+    }
+  };
+
+  // Ready instructions are partitioned into queues based on their instruction
+  // descriptor. Instructions from a same queue consume the same reservation
+  // stations and processor resources, so either all of them can be issued, or
+  // none. Each queue is sorted by rank, so the best candidate to issue is
+  // always the first element of a queue.
+  using ReadyQueue = std::set<ReadyEntry>;
+  std::vector<ReadyQueue> ReadySet;
+  llvm::DenseMap<const InstrDesc *, unsigned> ReadyQueueIndices;
+
+  // Maps the source index of every ready instruction to its rank.
+  llvm::DenseMap<unsigned, int> ReadyRanks;
+
+  // Maps register writes of ready instructions to the instruction. This is
+  // used to update ranks when new users are dispatched.
+  llvm::DenseMap<const WriteState *, InstRef> ReadyWrites;
+
   std::vector<InstRef> IssuedSet;
 
   /// Verify the given selection strategy and set the Strategy member
@@ -103,33 +173,70 @@ class Scheduler : public HardwareUnit {
   /// Issue an instruction without updating the ready queue.
   void issueInstructionImpl(
       InstRef &IR,
-      llvm::SmallVectorImpl<std::pair<ResourceRef, double>> &Pipes);
+      llvm::SmallVectorImpl<std::pair<ResourceRef, double>> *Pipes);
 
   // Identify instructions that have finished executing, and remove them from
   // the IssuedSet. References to executed instructions are added to input
   // vector 'Executed'.
   void updateIssuedSet(llvm::SmallVectorImpl<InstRef> &Executed);
 
-  // Try to promote instructions from WaitSet to ReadySet.
+  // Adds IR to the WaitSet, and registers it to the events that can make it
+  // ready.
+  void addToWaitSet(const InstRef &IR);
+
+  // Schedules a waiting instruction for the next wakeup event. Instructions
+  // with ready register operands are moved to the PendingSet.
+  void scheduleWakeup(const WaitEntry &Entry);
+
+  // Collects the waiting instructions that depend on register writes from IR,
+  // and updates them to the current cycle. This must be done before IR is
+  // issued, so that waiting reads observe the correct number of cycles left.
+  void collectDependentInstructions(const InstRef &IR,
+                                    llvm::SmallVectorImpl<unsigned> &Users);
+
+  // Wakes up instructions from the WakeupQueue that are expected to become
+  // ready during this cycle.
+  void wakeupInstructions();
+
+  // Inserts IR into its ready queue.
+  void addToReadySet(const InstRef &IR);
+
+  // Recomputes the rank of ready instruction IR.
+  void updateRank(const InstRef &IR);
+
+  // Updates the rank of ready instructions which have register writes consumed
+  // by IR.
+  void updateProducerRanks(const InstRef &IR);
+
+  // Try to promote instructions from the PendingSet to the ReadySet.
   // Add promoted instructions to the 'Ready' vector in input.
   void promoteToReadySet(llvm::SmallVectorImpl<InstRef> &Ready);
 
 public:
   Scheduler(const llvm::MCSchedModel &Model, LSUnit *Lsu)
-      : LSU(Lsu), Resources(llvm::make_unique<ResourceManager>(Model)) {
+      : LSU(Lsu), Resources(llvm::make_unique<ResourceManager>(Model)),
+        CurrentCycle(0), ScanCounters(nullptr) {
     initializeStrategy(nullptr);
   }
   Scheduler(const llvm::MCSchedModel &Model, LSUnit *Lsu,
             std::unique_ptr<SchedulerStrategy> SelectStrategy)
-      : LSU(Lsu), Resources(llvm::make_unique<ResourceManager>(Model)) {
+      : LSU(Lsu), Resources(llvm::make_unique<ResourceManager>(Model)),
+        CurrentCycle(0), ScanCounters(nullptr) {
     initializeStrategy(std::move(SelectStrategy));
   }
   Scheduler(std::unique_ptr<ResourceManager> RM, LSUnit *Lsu,
             std::unique_ptr<SchedulerStrategy> SelectStrategy)
-      : LSU(Lsu), Resources(std::move(RM)) {
+      : LSU(Lsu), Resources(std::move(RM)), CurrentCycle(0),
+        ScanCounters(nullptr) {
     initializeStrategy(std::move(SelectStrategy));
   }
 
+  // Sets the counters of the entries scanned by this scheduler, or disables
+  // counting if C is null.
+  void setScanCounters(PipelineProfiler::SchedulerCounters *C) {
+    ScanCounters = C;
+  }
+
   // Stalls generated by the scheduler.
   enum Status {
     SC_AVAILABLE,
@@ -163,10 +270,11 @@ public:
 
   /// Issue an instruction and populates a vector of used pipeline resources,
   /// and a vector of instructions that transitioned to the ready state as a
-  /// result of this event.
+  /// result of this event. Used can be null if the caller is not interested
+  /// in the pipeline resources.
   void
   issueInstruction(InstRef &IR,
-                   llvm::SmallVectorImpl<std::pair<ResourceRef, double>> &Used,
+                   llvm::SmallVectorImpl<std::pair<ResourceRef, double>> *Used,
                    llvm::SmallVectorImpl<InstRef> &Ready);
 
   /// Returns true if IR has to be issued immediately, or if IR is a zero
@@ -184,6 +292,18 @@ public:
                   llvm::SmallVectorImpl<InstRef> &Ready,
                   llvm::SmallVectorImpl<InstRef> &Executed);
 
+  /// Returns the number of upcoming cycles in which method `cycleEvent()` is
+  /// guaranteed to not release resources, nor to change the state of any
+  /// instruction in the scheduler's queues.
+  ///
+  /// Returns zero if the scheduler may issue instructions in the next cycle.
+  unsigned getNumIdleCycles() const;
+
+  /// Simulates NumCycles idle calls to method `cycleEvent()`.
+  /// It is an error to skip more cycles than what is returned by method
+  /// `getNumIdleCycles()`.
+  void skipCycles(unsigned NumCycles);
+
   /// Convert a resource mask into a valid llvm processor resource identifier.
   unsigned getResourceID(uint64_t Mask) const {
     return Resources->resolveResourceMask(Mask);
@@ -194,6 +314,12 @@ public:
   /// resources are not available.
   InstRef select();
 
+  /// Appends to S the content of the scheduler queues, as well as the state of
+  /// the processor resources and of the LSUnit. Waiting instructions are
+  /// updated lazily, so the number of cycles since their last update is also
+  /// part of the state.
+  void encodeState(StateSignature &S) const;
+
 #ifndef NDEBUG
   // Update the ready queues.
   void dump() const;
@@ -201,8 +327,9 @@ public:
   // This routine performs a sanity check.  This routine should only be called
   // when we know that 'IR' is not in the scheduler's instruction queues.
   void sanityCheck(const InstRef &IR) const {
-    assert(llvm::find(WaitSet, IR) == WaitSet.end());
-    assert(llvm::find(ReadySet, IR) == ReadySet.end());
+    assert(!WaitSet.count(IR.getSourceIndex()));
+    assert(llvm::find(PendingSet, IR) == PendingSet.end());
+    assert(!ReadyRanks.count(IR.getSourceIndex()));
     assert(llvm::find(IssuedSet, IR) == IssuedSet.end());
   }
 #endif // !NDEBUG
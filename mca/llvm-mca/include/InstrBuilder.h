@@ -17,16 +17,34 @@
 
 #include "Instruction.h"
 #include "Support.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/MC/MCInstPrinter.h"
 #include "llvm/MC/MCInstrAnalysis.h"
 #include "llvm/MC/MCInstrInfo.h"
 #include "llvm/MC/MCRegisterInfo.h"
 #include "llvm/MC/MCSubtargetInfo.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
 
 namespace mca {
 
 class DispatchUnit;
+class InstrDescCache;
+
+/// Allocation statistics collected by the InstrBuilder.
+struct InstructionPoolStats {
+  // Number of instructions returned by method createInstruction().
+  unsigned NumCreated;
+  // Number of instructions that reused the storage of a retired instruction.
+  unsigned NumReused;
+  // Number of heap allocations performed while creating instructions. This
+  // includes allocations of register operand storage.
+  unsigned NumAllocations;
+  // Maximum number of instructions alive at the same time.
+  unsigned MaxInFlight;
+  // Memory owned by the instruction pool, in bytes.
+  uint64_t PoolSize;
+};
 
 /// A builder class that knows how to construct Instruction objects.
 ///
@@ -46,21 +64,45 @@ class InstrBuilder {
   llvm::MCInstPrinter &MCIP;
   llvm::SmallVector<uint64_t, 8> ProcResourceMasks;
 
-  llvm::DenseMap<unsigned short, std::unique_ptr<const InstrDesc>> Descriptors;
-  llvm::DenseMap<const llvm::MCInst *, std::unique_ptr<const InstrDesc>>
-      VariantDescriptors;
+  // Descriptors are allocated in DescAllocator. DescData is a scratch object
+  // used to populate the content of a new descriptor.
+  llvm::BumpPtrAllocator DescAllocator;
+  InstrDescData DescData;
+
+  llvm::DenseMap<unsigned short, const InstrDesc *> Descriptors;
+
+  // Descriptors of opcodes with a variant scheduling class. They are shared by
+  // every MCInst that resolves to the same scheduling class and has the same
+  // operand layout (see function getLayoutKey()).
+  llvm::StringMap<const InstrDesc *> ResolvedVariants;
+  // Variant descriptors indexed by the content of the MCInst (see function
+  // getOperandsKey()). Identical instructions share a descriptor without
+  // resolving their scheduling class again, even across code regions.
+  llvm::StringMap<const InstrDesc *> VariantDescriptors;
+
+  // An optional persistent cache of descriptors, shared with other builders.
+  InstrDescCache *DescCache;
+
+  // Stream where diagnostics about the input instructions are printed.
+  llvm::raw_ostream *DiagOS;
+
+  // Retired instructions whose storage can be reused by createInstruction().
+  // The pool grows up to the maximum number of instructions in flight, which
+  // is bounded by the size of the instruction window. After that, creating
+  // an instruction doesn't require heap allocations.
+  std::vector<std::unique_ptr<Instruction>> InstructionPool;
+  unsigned NumInFlight;
+  InstructionPoolStats Stats;
 
   llvm::Expected<const InstrDesc &>
   createInstrDescImpl(const llvm::MCInst &MCI);
-  llvm::Expected<const InstrDesc &>
-  getOrCreateInstrDesc(const llvm::MCInst &MCI);
 
   InstrBuilder(const InstrBuilder &) = delete;
   InstrBuilder &operator=(const InstrBuilder &) = delete;
 
-  llvm::Error populateWrites(InstrDesc &ID, const llvm::MCInst &MCI,
+  llvm::Error populateWrites(InstrDescData &ID, const llvm::MCInst &MCI,
                              unsigned SchedClassID);
-  llvm::Error populateReads(InstrDesc &ID, const llvm::MCInst &MCI,
+  llvm::Error populateReads(InstrDescData &ID, const llvm::MCInst &MCI,
                             unsigned SchedClassID);
 
 public:
@@ -68,7 +110,8 @@ public:
                const llvm::MCRegisterInfo &mri,
                const llvm::MCInstrAnalysis &mcia, llvm::MCInstPrinter &mcip)
       : STI(sti), MCII(mcii), MRI(mri), MCIA(mcia), MCIP(mcip),
-        ProcResourceMasks(STI.getSchedModel().getNumProcResourceKinds()) {
+        ProcResourceMasks(STI.getSchedModel().getNumProcResourceKinds()),
+        DescCache(nullptr), DiagOS(&llvm::errs()), NumInFlight(0), Stats() {
     computeProcResourceMasks(STI.getSchedModel(), ProcResourceMasks);
   }
 
@@ -80,10 +123,37 @@ public:
     return ProcResourceMasks;
   }
 
-  void clear() { VariantDescriptors.shrink_and_clear(); }
+  // Clears the instruction pool and the allocation statistics. Dropping the
+  // pool makes the statistics of a simulation independent from the
+  // simulations that preceded it, so a report doesn't change when regions are
+  // simulated by different builders. Descriptors are content addressed, so
+  // they are kept for later simulations.
+  void clear() {
+    assert(!NumInFlight && "Instructions are still in flight!");
+    InstructionPool.clear();
+    Stats = InstructionPoolStats();
+  }
+
+  // Sets a persistent cache of descriptors. Descriptors missing from the
+  // in-memory tables are looked up in Cache before being built, and new
+  // descriptors are inserted in Cache.
+  void setDescriptorCache(InstrDescCache *Cache) { DescCache = Cache; }
+
+  // Sets the stream where warnings and errors about unsupported or partially
+  // modeled instructions are printed. By default, they go to stderr.
+  void setDiagnosticStream(llvm::raw_ostream &OS) { DiagOS = &OS; }
+
+  // Returns the descriptor of MCI. Descriptors are built on first use.
+  llvm::Expected<const InstrDesc &>
+  getOrCreateInstrDesc(const llvm::MCInst &MCI);
 
   llvm::Expected<std::unique_ptr<Instruction>>
   createInstruction(const llvm::MCInst &MCI);
+
+  // Returns a retired instruction to the pool.
+  void recycleInstruction(std::unique_ptr<Instruction> IS);
+
+  const InstructionPoolStats &getInstructionPoolStats() const { return Stats; }
 };
 } // namespace mca
 
@@ -0,0 +1,103 @@
+//===--------------------- InstrDescCache.h ---------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file defines a persistent cache of instruction descriptors.
+///
+/// Building an InstrDesc requires expanding processor resource groups, and
+/// querying the scheduling model for write latencies. The outcome only
+/// depends on the scheduling model and on the instruction info of the
+/// target. This cache stores descriptors in a compact binary file that is
+/// memory mapped, and decoded on demand by the InstrBuilder.
+///
+/// A cache file is keyed by target triple, cpu and LLVM version. The file
+/// also stores a fingerprint of the scheduling model and of the instruction
+/// info, so that stale files are never used if the scheduling model changes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCA_INSTRDESCCACHE_H
+#define LLVM_TOOLS_LLVM_MCA_INSTRDESCCACHE_H
+
+#include "Instruction.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/MC/MCInstrInfo.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace mca {
+
+/// A persistent cache of non-variant instruction descriptors, indexed by
+/// opcode.
+///
+/// Method lookup() can be called concurrently by different InstrBuilder
+/// objects. Method insert() records descriptors created during this run;
+/// they are written to disk by method save().
+///
+/// Cache file layout (all fields are little-endian):
+///
+///   Header:  magic, format version, fingerprint, key size, number of entries
+///   Key:     "<triple>:<cpu>:<llvm version>"
+///   Index:   {opcode, record offset} pairs, sorted by opcode
+///   Records: one encoded InstrDesc per entry
+class InstrDescCache {
+  std::string Path;
+  std::string Key;
+  uint64_t Fingerprint;
+
+  // The content of the cache file, or null if the file is missing or invalid.
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  const char *Index;
+  unsigned NumEntries;
+
+  // Encoded descriptors inserted during this run, indexed by opcode.
+  std::mutex Lock;
+  llvm::DenseMap<unsigned, std::string> NewRecords;
+
+  InstrDescCache(llvm::StringRef Path, llvm::StringRef Key,
+                 uint64_t Fingerprint);
+  bool loadFile();
+  llvm::StringRef getRecord(unsigned Opcode) const;
+
+public:
+  InstrDescCache(const InstrDescCache &) = delete;
+  InstrDescCache &operator=(const InstrDescCache &) = delete;
+
+  /// Opens the cache file for the given triple and subtarget in directory
+  /// Dir. A missing or stale file is not an error: the cache starts empty,
+  /// and the file is replaced by save().
+  static std::unique_ptr<InstrDescCache> open(llvm::StringRef Dir,
+                                              llvm::StringRef Triple,
+                                              const llvm::MCSubtargetInfo &STI,
+                                              const llvm::MCInstrInfo &MCII);
+
+  /// Decodes the descriptor of Opcode into ID. NumOperands is the number of
+  /// operands of the MCInst being analyzed; descriptors built for an MCInst
+  /// with a different number of operands are ignored. Returns false if the
+  /// descriptor is not in the cache.
+  bool lookup(unsigned Opcode, unsigned NumOperands, InstrDescData &ID) const;
+
+  /// Records the descriptor of Opcode, which was built for an MCInst with
+  /// NumOperands operands.
+  void insert(unsigned Opcode, unsigned NumOperands, const InstrDesc &ID);
+
+  /// Writes the cache file if new descriptors have been inserted. The file
+  /// is replaced atomically, so concurrent processes never observe a partial
+  /// file.
+  llvm::Error save();
+};
+
+} // namespace mca
+
+#endif // LLVM_TOOLS_LLVM_MCA_INSTRDESCCACHE_H
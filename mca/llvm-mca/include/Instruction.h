@@ -16,21 +16,31 @@
 #ifndef LLVM_TOOLS_LLVM_MCA_INSTRUCTION_H
 #define LLVM_TOOLS_LLVM_MCA_INSTRUCTION_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/TrailingObjects.h"
 
 #ifndef NDEBUG
 #include "llvm/Support/raw_ostream.h"
 #endif
 
+#include <limits>
 #include <memory>
-#include <set>
 #include <vector>
 
 namespace mca {
 
+class StateSignature;
+
 constexpr int UNKNOWN_CYCLES = -512;
 
+// Number of idle cycles reported by components that are not waiting on any
+// timed event. Those components only change state in response to other events.
+constexpr unsigned UNBOUNDED_IDLE_CYCLES = std::numeric_limits<unsigned>::max();
+
 /// A register write descriptor.
 struct WriteDescriptor {
   // Operand index. The index is negative for implicit writes only.
@@ -106,25 +116,33 @@ class WriteState {
   // dependency on any previous write of the same register (or a portion of it).
   // DependentWrite must be able to complete before this write completes, so
   // that we don't break the WAW, and the two writes can be merged together.
-  const WriteState *DependentWrite;
+  WriteState *DependentWrite;
 
-  // Number of writes that are in a WAW dependency with this write.
-  unsigned NumWriteUsers;
+  // Partial writes that are in a WAW dependency with this write (i.e. writes
+  // whose DependentWrite is this write).
+  llvm::SmallVector<WriteState *, 1> WriteUsers;
 
-  // A list of dependent reads. Users is a set of dependent
-  // reads. A dependent read is added to the set only if CyclesLeft
-  // is "unknown". As soon as CyclesLeft is 'known', each user in the set
-  // gets notified with the actual CyclesLeft.
+  // A list of dependent reads, in the order in which they were added. A
+  // dependent read is added to the list only if CyclesLeft is "unknown". As
+  // soon as CyclesLeft is 'known', each user in the list gets notified with
+  // the actual CyclesLeft. A read cannot be added more than once.
 
   // The 'second' element of a pair is a "ReadAdvance" number of cycles.
-  std::set<std::pair<ReadState *, int>> Users;
+  llvm::SmallVector<std::pair<ReadState *, int>, 4> Users;
+
+  // The last query of RegisterFile::collectWrites() that returned this write.
+  // It is used by the register file to return each write at most once. Query
+  // generations start at 1, and are 64-bit so that they never wrap around
+  // back to the initial value of a new write.
+  mutable uint64_t CollectGeneration;
 
 public:
   WriteState(const WriteDescriptor &Desc, unsigned RegID,
              bool clearsSuperRegs = false)
       : WD(Desc), CyclesLeft(UNKNOWN_CYCLES), RegisterID(RegID),
         ClearsSuperRegs(clearsSuperRegs), DependentWrite(nullptr),
-        NumWriteUsers(0U) {}
+        CollectGeneration(0) {}
+  WriteState(WriteState &&Other) = default;
   WriteState(const WriteState &Other) = delete;
   WriteState &operator=(const WriteState &Other) = delete;
 
@@ -135,19 +153,46 @@ public:
 
   void addUser(ReadState *Use, int ReadAdvance);
 
-  unsigned getNumUsers() const { return Users.size() + NumWriteUsers; }
+  llvm::ArrayRef<std::pair<ReadState *, int>> getUsers() const {
+    return Users;
+  }
+
+  unsigned getNumUsers() const { return Users.size() + WriteUsers.size(); }
   bool clearsSuperRegisters() const { return ClearsSuperRegs; }
 
+  // Marks this write as collected by query Generation. Returns false if it
+  // was already collected by that query.
+  bool markCollected(uint64_t Generation) const {
+    if (CollectGeneration == Generation)
+      return false;
+    CollectGeneration = Generation;
+    return true;
+  }
+
   const WriteState *getDependentWrite() const { return DependentWrite; }
   void setDependentWrite(WriteState *Other) {
     DependentWrite = Other;
-    ++Other->NumWriteUsers;
+    Other->WriteUsers.push_back(this);
   }
 
+  llvm::ArrayRef<WriteState *> getDependentWriteUsers() const {
+    return WriteUsers;
+  }
+
+  // Removes the false dependency between this write and every partial write
+  // that depends on it. This must be called as soon as the owning instruction
+  // is released, so that dependent writes never observe a stale state.
+  void releaseWriteUsers();
+
   // On every cycle, update CyclesLeft and notify dependent users.
   void cycleEvent();
+  // Equivalent to NumCycles calls to cycleEvent().
+  void skipCycles(unsigned NumCycles);
   void onInstructionIssued();
 
+  // Appends the state of this write to S. Users are not encoded.
+  void encodeState(StateSignature &S) const;
+
 #ifndef NDEBUG
   void dump() const;
 #endif
@@ -177,11 +222,15 @@ class ReadState {
   // This field is set to true only if there are no dependent writes, and
   // there are no `CyclesLeft' to wait.
   bool IsReady;
+  // Dependent writes that had not been issued yet at the time this read was
+  // dispatched.
+  llvm::SmallVector<const WriteState *, 1> PendingWrites;
 
 public:
   ReadState(const ReadDescriptor &Desc, unsigned RegID)
       : RD(Desc), RegisterID(RegID), DependentWrites(0),
         CyclesLeft(UNKNOWN_CYCLES), TotalCycles(0), IsReady(true) {}
+  ReadState(ReadState &&Other) = default;
   ReadState(const ReadState &Other) = delete;
   ReadState &operator=(const ReadState &Other) = delete;
 
@@ -189,11 +238,23 @@ public:
   unsigned getSchedClass() const { return RD.SchedClassID; }
   unsigned getRegisterID() const { return RegisterID; }
 
+  int getCyclesLeft() const { return CyclesLeft; }
+
+  llvm::ArrayRef<const WriteState *> getPendingWrites() const {
+    return PendingWrites;
+  }
+  void addPendingWrite(const WriteState *Write) {
+    PendingWrites.push_back(Write);
+  }
+
   bool isReady() const { return IsReady; }
   bool isImplicitRead() const { return RD.isImplicitRead(); }
 
   void cycleEvent();
+  // Equivalent to NumCycles calls to cycleEvent().
+  void skipCycles(unsigned NumCycles);
   void writeStartEvent(unsigned Cycles);
+  void encodeState(StateSignature &S) const;
   void setDependentWrites(unsigned Writes) {
     DependentWrites = Writes;
     IsReady = !Writes;
@@ -260,14 +321,18 @@ struct ResourceUsage {
   void setReserved() { CS.setReserved(); }
 };
 
-/// An instruction descriptor
-struct InstrDesc {
+using ResourcePlusCycles = std::pair<uint64_t, ResourceUsage>;
+
+/// The content of an instruction descriptor, in a form that is easy to
+/// populate. The InstrBuilder fills an object of this class, and then copies
+/// it into a flat InstrDesc (see InstrDesc::create()).
+struct InstrDescData {
   std::vector<WriteDescriptor> Writes; // Implicit writes are at the end.
   std::vector<ReadDescriptor> Reads;   // Implicit reads are at the end.
 
   // For every resource used by an instruction of this kind, this vector
   // reports the number of "consumed cycles".
-  std::vector<std::pair<uint64_t, ResourceUsage>> Resources;
+  std::vector<ResourcePlusCycles> Resources;
 
   // A list of buffered resources consumed by this instruction.
   std::vector<uint64_t> Buffers;
@@ -279,8 +344,77 @@ struct InstrDesc {
   bool MayStore;
   bool HasSideEffects;
 
+  InstrDescData() { clear(); }
+
+  // Resets this object, but retains the storage of the vectors.
+  void clear();
+};
+
+/// An instruction descriptor
+///
+/// A descriptor is a fixed size header immediately followed by its arrays of
+/// resources, buffers, writes and reads. Descriptors are allocated in an
+/// arena owned by the InstrBuilder, so that the data used by the hardware
+/// units to dispatch and issue an instruction is contiguous in memory.
+struct InstrDesc final
+    : private llvm::TrailingObjects<InstrDesc, ResourcePlusCycles, uint64_t,
+                                    WriteDescriptor, ReadDescriptor> {
+  unsigned MaxLatency;
+  // Number of MicroOps for this instruction.
+  unsigned NumMicroOps;
+
+  bool MayLoad;
+  bool MayStore;
+  bool HasSideEffects;
+
+private:
+  friend TrailingObjects;
+
+  unsigned NumResources;
+  unsigned NumBuffers;
+  unsigned NumWrites;
+  unsigned NumReads;
+
+  size_t numTrailingObjects(OverloadToken<ResourcePlusCycles>) const {
+    return NumResources;
+  }
+  size_t numTrailingObjects(OverloadToken<uint64_t>) const {
+    return NumBuffers;
+  }
+  size_t numTrailingObjects(OverloadToken<WriteDescriptor>) const {
+    return NumWrites;
+  }
+
+  InstrDesc(const InstrDescData &Data);
+
+public:
+  InstrDesc(const InstrDesc &) = delete;
+  InstrDesc &operator=(const InstrDesc &) = delete;
+
+  /// Allocates in Alloc a descriptor with the content of Data.
+  static const InstrDesc *create(llvm::BumpPtrAllocator &Alloc,
+                                 const InstrDescData &Data);
+
+  // Implicit writes are at the end.
+  llvm::ArrayRef<WriteDescriptor> getWrites() const {
+    return {getTrailingObjects<WriteDescriptor>(), NumWrites};
+  }
+  // Implicit reads are at the end.
+  llvm::ArrayRef<ReadDescriptor> getReads() const {
+    return {getTrailingObjects<ReadDescriptor>(), NumReads};
+  }
+  // For every resource used by an instruction of this kind, this array
+  // reports the number of "consumed cycles".
+  llvm::ArrayRef<ResourcePlusCycles> getResources() const {
+    return {getTrailingObjects<ResourcePlusCycles>(), NumResources};
+  }
+  // A list of buffered resources consumed by this instruction.
+  llvm::ArrayRef<uint64_t> getBuffers() const {
+    return {getTrailingObjects<uint64_t>(), NumBuffers};
+  }
+
   // A zero latency instruction doesn't consume any scheduler resources.
-  bool isZeroLatency() const { return !MaxLatency && Resources.empty(); }
+  bool isZeroLatency() const { return !MaxLatency && !NumResources; }
 };
 
 /// An instruction propagated through the simulated instruction pipeline.
@@ -288,7 +422,7 @@ struct InstrDesc {
 /// This class is used to monitor changes to the internal state of instructions
 /// that are sent to the various components of the simulated hardware pipeline.
 class Instruction {
-  const InstrDesc &Desc;
+  const InstrDesc *Desc;
 
   enum InstrStage {
     IS_INVALID,   // Instruction in an invalid state.
@@ -311,11 +445,15 @@ class Instruction {
 
   bool IsDepBreaking;
 
-  using UniqueDef = std::unique_ptr<WriteState>;
-  using UniqueUse = std::unique_ptr<ReadState>;
-  using VecDefs = std::vector<UniqueDef>;
-  using VecUses = std::vector<UniqueUse>;
-
+public:
+  // Register operands are stored inline, so that the common case of an
+  // instruction with few register operands doesn't require extra heap
+  // allocations. Operands are never added after the instruction has been
+  // created, so pointers to elements of these vectors are stable.
+  using VecDefs = llvm::SmallVector<WriteState, 2>;
+  using VecUses = llvm::SmallVector<ReadState, 4>;
+
+private:
   // Output dependencies.
   // One entry per each implicit and explicit register definition.
   VecDefs Defs;
@@ -326,22 +464,26 @@ class Instruction {
 
 public:
   Instruction(const InstrDesc &D)
-      : Desc(D), Stage(IS_INVALID), CyclesLeft(UNKNOWN_CYCLES), RCUTokenID(0),
+      : Desc(&D), Stage(IS_INVALID), CyclesLeft(UNKNOWN_CYCLES), RCUTokenID(0),
         IsDepBreaking(false) {}
   Instruction(const Instruction &Other) = delete;
   Instruction &operator=(const Instruction &Other) = delete;
 
+  // Reinitializes this instruction with a new descriptor, so that the storage
+  // of a retired instruction can be reused. Register operands are discarded.
+  void reset(const InstrDesc &D);
+
   VecDefs &getDefs() { return Defs; }
   const VecDefs &getDefs() const { return Defs; }
   VecUses &getUses() { return Uses; }
   const VecUses &getUses() const { return Uses; }
-  const InstrDesc &getDesc() const { return Desc; }
+  const InstrDesc &getDesc() const { return *Desc; }
   unsigned getRCUTokenID() const { return RCUTokenID; }
   int getCyclesLeft() const { return CyclesLeft; }
 
   bool hasDependentUsers() const {
-    return llvm::any_of(Defs, [](const UniqueDef &Def) {
-      return Def->getNumUsers() > 0;
+    return llvm::any_of(Defs, [](const WriteState &Def) {
+      return Def.getNumUsers() > 0;
     });
   }
 
@@ -350,8 +492,8 @@ public:
 
   unsigned getNumUsers() const {
     unsigned NumUsers = 0;
-    for (const UniqueDef &Def : Defs)
-      NumUsers += Def->getNumUsers();
+    for (const WriteState &Def : Defs)
+      NumUsers += Def.getNumUsers();
     return NumUsers;
   }
 
@@ -384,6 +526,20 @@ public:
   }
 
   void cycleEvent();
+
+  // Returns the number of cycles that this instruction is guaranteed to spend
+  // in its current stage, ignoring events generated by other instructions.
+  // Only dispatched and executing instructions are subject to timed state
+  // transitions; every other stage reports UNBOUNDED_IDLE_CYCLES.
+  unsigned getNumIdleCycles() const;
+
+  // Simulates NumCycles calls to cycleEvent() at once. It is an error to skip
+  // more than getNumIdleCycles() cycles.
+  void skipCycles(unsigned NumCycles);
+
+  // Appends the state of this instruction and of its register operands to S.
+  // Dependencies between register operands are not encoded.
+  void encodeState(StateSignature &S) const;
 };
 
 /// An InstRef contains both a SourceMgr index and Instruction pair.  The index
@@ -17,7 +17,11 @@
 #define LLVM_TOOLS_LLVM_MCA_PIPELINE_H
 
 #include "HardwareUnits/Scheduler.h"
+#include "PipelineProfiler.h"
+#include "SourceMgr.h"
+#include "StateSignature.h"
 #include "Stages/Stage.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Error.h"
 
@@ -48,6 +52,23 @@ class HWStallEvent;
 /// until there are new instructions to dispatch, and not every instruction
 /// has been retired.
 ///
+/// When event-driven simulation is enabled, the Pipeline asks every stage for
+/// the number of upcoming cycles in which nothing can happen, and fast-forwards
+/// through those cycles. Listeners still observe every cycle begin/end event,
+/// as well as stall events, so the simulation output is unchanged.
+///
+/// When steady-state extrapolation is enabled, the Pipeline encodes the state
+/// of every stage each time a new iteration starts being fetched, and looks
+/// for a previous iteration that started from an identical state. Since the
+/// simulation is deterministic, a match means that the simulation has become
+/// periodic. The candidate period is then verified by simulating it once more
+/// and comparing the full state at its end; if it matches, listeners are asked
+/// to extrapolate their statistics, and the remaining repetitions of the
+/// period are never simulated.
+///
+/// Listeners are only notified of the kinds of event they subscribed to (see
+/// HWEventListener::getSubscribedEvents()).
+///
 /// Internally, the Pipeline collects statistical information in the form of
 /// histograms. For example, it tracks how the dispatch group size changes
 /// over time.
@@ -57,19 +78,62 @@ class Pipeline {
 
   /// An ordered list of stages that define this instruction pipeline.
   llvm::SmallVector<std::unique_ptr<Stage>, 8> Stages;
-  std::set<HWEventListener *> Listeners;
+  HWEventListenerTable Listeners;
   unsigned Cycles;
 
+  // Null unless profiling is enabled.
+  PipelineProfiler *Profiler;
+
+  // True if idle cycles should be skipped.
+  bool EventDriven;
+
+  // Steady-state detection. SteadyStateSource is null if extrapolation is
+  // disabled, or if it has already been performed.
+  struct Checkpoint {
+    unsigned Iteration;
+    unsigned Cycle;
+  };
+  SourceMgr *SteadyStateSource;
+  unsigned LastIteration;
+  // The most recent checkpoint taken for each state hash.
+  llvm::DenseMap<size_t, Checkpoint> Checkpoints;
+  // The period currently being verified, and the state at its beginning.
+  Checkpoint PeriodStart;
+  unsigned Period;
+  std::unique_ptr<StateSignature> PeriodStartState;
+
+  // Give up on extrapolation if no candidate period is found within this
+  // number of iterations.
+  static const unsigned MaxCheckpoints = 1024;
+
   llvm::Error runCycle();
+  llvm::Error runProfiledCycle();
+  void skipIdleCycles();
+  void checkSteadyState();
+  void extrapolatePeriod();
   bool hasWorkToProcess();
   void notifyCycleBegin();
   void notifyCycleEnd();
 
 public:
-  Pipeline() : Cycles(0) {}
+  Pipeline(bool SkipIdleCycles = false)
+      : Cycles(0), Profiler(nullptr), EventDriven(SkipIdleCycles),
+        SteadyStateSource(nullptr), LastIteration(0), PeriodStart({0, 0}),
+        Period(0) {}
   void appendStage(std::unique_ptr<Stage> S);
+  void enableSteadyStateExtrapolation(SourceMgr &SM) {
+    SteadyStateSource = &SM;
+  }
   llvm::Error run();
   void addEventListener(HWEventListener *Listener);
+
+  /// Enables profiling of the stages and of the listeners of this pipeline.
+  /// Stages must be appended before calling this method.
+  void setProfiler(PipelineProfiler &P);
+
+  /// Returns the number of cycles simulated so far, including the cycles of
+  /// the extrapolated steady-state periods.
+  unsigned getNumCycles() const { return Cycles; }
 };
 } // namespace mca
 
@@ -0,0 +1,148 @@
+//===--------------------- PipelineProfiler.h -------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file defines class PipelineProfiler, which measures where the time of
+/// a simulation goes.
+///
+/// Time is attributed to the innermost active entity: the pipeline itself, a
+/// stage, or an event listener. Stages call each other through
+/// Stage::moveToTheNextStage(), and notify listeners in the middle of their
+/// own work, so entities are tracked on a stack, and every entity is only
+/// charged its self time.
+///
+/// Profiling is disabled unless a profiler is attached to the pipeline with
+/// Pipeline::setProfiler(). Instrumented code only tests a null pointer when
+/// profiling is disabled.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCA_PIPELINEPROFILER_H
+#define LLVM_TOOLS_LLVM_MCA_PIPELINEPROFILER_H
+
+#include "HWEventListener.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mca {
+
+class PipelineProfiler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // The number of times an entity was entered, and its self time.
+  struct Counter {
+    std::string Name;
+    uint64_t Calls;
+    Clock::duration Time;
+
+    Counter(llvm::StringRef N)
+        : Name(N), Calls(0), Time(Clock::duration::zero()) {}
+  };
+
+  // The number of entries visited by the scheduler when scanning its sets.
+  struct SchedulerCounters {
+    // Instructions of the WaitSet updated on a wake up event.
+    uint64_t WaitSetUpdates;
+    // Entries of the pending set checked for promotion to the ReadySet.
+    uint64_t PendingSetScans;
+    // Queues of the ReadySet inspected by the selection of an instruction.
+    uint64_t ReadyQueueScans;
+    // Entries of the IssuedSet checked for completion.
+    uint64_t IssuedSetScans;
+  };
+
+private:
+  Counter PipelineCounter;
+  std::vector<Counter> StageCounters;
+  std::vector<Counter> ListenerCounters;
+  llvm::DenseMap<const HWEventListener *, unsigned> ListenerIndices;
+  SchedulerCounters Scheduler;
+
+  // The entities that are currently active. The last one is charged the time
+  // elapsed since LastTime.
+  llvm::SmallVector<Counter *, 8> Stack;
+  Clock::time_point LastTime;
+
+public:
+  PipelineProfiler() : PipelineCounter("Pipeline"), Scheduler() {}
+  PipelineProfiler(const PipelineProfiler &) = delete;
+  PipelineProfiler &operator=(const PipelineProfiler &) = delete;
+
+  // Registers a stage, and returns the index of its counter.
+  unsigned addStage(llvm::StringRef Name) {
+    StageCounters.emplace_back(Name);
+    return StageCounters.size() - 1;
+  }
+
+  Counter &getPipelineCounter() { return PipelineCounter; }
+  Counter &getStageCounter(unsigned Index) { return StageCounters[Index]; }
+  Counter &getListenerCounter(const HWEventListener &Listener);
+  SchedulerCounters &getSchedulerCounters() { return Scheduler; }
+
+  const Counter &getPipelineCounter() const { return PipelineCounter; }
+  llvm::ArrayRef<Counter> getStageCounters() const { return StageCounters; }
+  llvm::ArrayRef<Counter> getListenerCounters() const {
+    return ListenerCounters;
+  }
+  const SchedulerCounters &getSchedulerCounters() const { return Scheduler; }
+
+  void enter(Counter &C) {
+    Clock::time_point Now = Clock::now();
+    if (!Stack.empty())
+      Stack.back()->Time += Now - LastTime;
+    LastTime = Now;
+    ++C.Calls;
+    Stack.push_back(&C);
+  }
+
+  void leave() {
+    Clock::time_point Now = Clock::now();
+    Stack.pop_back_val()->Time += Now - LastTime;
+    LastTime = Now;
+  }
+
+  // Charges the time spent in the lifetime of this object to a counter.
+  class Scope {
+    PipelineProfiler &P;
+
+  public:
+    Scope(PipelineProfiler &Profiler, Counter &C) : P(Profiler) { P.enter(C); }
+    ~Scope() { P.leave(); }
+  };
+};
+
+/// Invokes Fn on every listener in Listeners. If Profiler is not null, each
+/// invocation is charged to the counter of the listener.
+template <typename FnT>
+void notifyListeners(llvm::ArrayRef<HWEventListener *> Listeners,
+                     PipelineProfiler *Profiler, FnT Fn) {
+  if (LLVM_LIKELY(!Profiler)) {
+    for (HWEventListener *Listener : Listeners)
+      Fn(*Listener);
+    return;
+  }
+
+  for (HWEventListener *Listener : Listeners) {
+    PipelineProfiler::Scope S(*Profiler,
+                              Profiler->getListenerCounter(*Listener));
+    Fn(*Listener);
+  }
+}
+
+} // namespace mca
+
+#endif // LLVM_TOOLS_LLVM_MCA_PIPELINEPROFILER_H
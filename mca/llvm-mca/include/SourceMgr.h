@@ -28,21 +28,42 @@ class SourceMgr {
   const InstVec &Sequence;
   unsigned Current;
   unsigned Iterations;
+  // Number of iterations whose simulation has been extrapolated by the
+  // pipeline. Those iterations are never fetched.
+  unsigned SkippedIterations;
   static const unsigned DefaultIterations = 100;
 
 public:
   SourceMgr(const InstVec &MCInstSequence, unsigned NumIterations)
       : Sequence(MCInstSequence), Current(0),
-        Iterations(NumIterations ? NumIterations : DefaultIterations) {}
+        Iterations(NumIterations ? NumIterations : DefaultIterations),
+        SkippedIterations(0) {}
 
   unsigned getCurrentIteration() const { return Current / Sequence.size(); }
   unsigned getNumIterations() const { return Iterations; }
   unsigned size() const { return Sequence.size(); }
   const InstVec &getSequence() const { return Sequence; }
 
-  bool hasNext() const { return Current < (Iterations * size()); }
+  bool hasNext() const {
+    return Current < ((Iterations - SkippedIterations) * size());
+  }
   void updateNext() { Current++; }
 
+  // Returns the number of instructions that are still to be fetched.
+  unsigned getNumInstructionsLeft() const {
+    return (Iterations - SkippedIterations) * size() - Current;
+  }
+
+  // Removes NumIterations iterations from the sequence. This is used by the
+  // pipeline when the outcome of those iterations has been extrapolated.
+  // Instructions fetched after this call keep their original source indices
+  // modulo the size of the sequence.
+  void skipIterations(unsigned NumIterations) {
+    assert(NumIterations * size() < getNumInstructionsLeft() &&
+           "Skipping too many iterations!");
+    SkippedIterations += NumIterations;
+  }
+
   const SourceRef peekNext() const {
     assert(hasNext() && "Already at end of sequence!");
     unsigned Index = getCurrentInstructionIndex();
@@ -24,6 +24,8 @@
 #include "HardwareUnits/RetireControlUnit.h"
 #include "Instruction.h"
 #include "Stages/Stage.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/MC/MCRegisterInfo.h"
 #include "llvm/MC/MCSubtargetInfo.h"
 
@@ -56,6 +58,26 @@ class DispatchStage final : public Stage {
   RetireControlUnit &RCU;
   RegisterFile &PRF;
 
+  // The number of physical registers required in every register file to
+  // rename the definitions of an instruction only depends on the registers
+  // defined by the instruction. Cost vectors are computed once for every
+  // descriptor and binding of the defined registers, and they are stored in
+  // PRFCosts, one element per register file.
+  struct PRFCostEntry {
+    llvm::SmallVector<unsigned, 2> RegDefs;
+    unsigned CostIndex;
+  };
+  mutable llvm::DenseMap<const InstrDesc *, llvm::SmallVector<PRFCostEntry, 1>>
+      PRFCostCache;
+  mutable std::vector<unsigned> PRFCosts;
+
+  // The cost vector that caused the last register file stall, and the
+  // register file generation observed at that time. Until the register file
+  // changes, the same cost vector always stalls.
+  mutable unsigned LastPRFStallCost;
+  mutable unsigned LastPRFStallGeneration;
+
+  unsigned getPRFCostIndex(const Instruction &IS) const;
   bool checkRCU(const InstRef &IR) const;
   bool checkPRF(const InstRef &IR) const;
   bool canDispatch(const InstRef &IR) const;
@@ -77,7 +99,10 @@ public:
                 const llvm::MCRegisterInfo &MRI, unsigned MaxDispatchWidth,
                 RetireControlUnit &R, RegisterFile &F)
       : DispatchWidth(MaxDispatchWidth), AvailableEntries(MaxDispatchWidth),
-        CarryOver(0U), CarriedOver(), STI(Subtarget), RCU(R), PRF(F) {}
+        CarryOver(0U), CarriedOver(), STI(Subtarget), RCU(R), PRF(F),
+        LastPRFStallCost(~0U), LastPRFStallGeneration(0) {}
+
+  llvm::StringRef getName() const override { return "DispatchStage"; }
 
   bool isAvailable(const InstRef &IR) const override;
 
@@ -87,6 +112,19 @@ public:
   llvm::Error cycleStart() override;
   llvm::Error execute(InstRef &IR) override;
 
+  // Dispatch only becomes busy when new instructions are fetched. The only
+  // exception is when the dispatch of a previous instruction is carried over
+  // multiple cycles, or when dispatch slots have been consumed in this cycle.
+  unsigned getNumIdleCycles() const override {
+    return CarryOver || AvailableEntries != DispatchWidth
+               ? 0
+               : UNBOUNDED_IDLE_CYCLES;
+  }
+
+  // Encodes the dispatch logic, as well as the retire control unit and the
+  // register file. Those are shared with the retire stage.
+  void encodeState(StateSignature &S) const override;
+
 #ifndef NDEBUG
   void dump() const;
 #endif
@@ -40,6 +40,14 @@ class ExecuteStage final : public Stage {
 public:
   ExecuteStage(Scheduler &S) : Stage(), HWS(S) {}
 
+  llvm::StringRef getName() const override { return "ExecuteStage"; }
+
+  // The scheduler counts the entries it scans while profiling.
+  void setProfiler(PipelineProfiler *P, unsigned Index) override {
+    Stage::setProfiler(P, Index);
+    HWS.setScanCounters(P ? &P->getSchedulerCounters() : nullptr);
+  }
+
   // This stage works under the assumption that the Pipeline will eventually
   // execute a retire stage. We don't need to check if pipelines and/or
   // schedulers have instructions to process, because those instructions are
@@ -59,6 +67,10 @@ public:
   llvm::Error cycleStart() override;
   llvm::Error execute(InstRef &IR) override;
 
+  unsigned getNumIdleCycles() const override { return HWS.getNumIdleCycles(); }
+  void skipCycles(unsigned NumCycles) override { HWS.skipCycles(NumCycles); }
+  void encodeState(StateSignature &S) const override { HWS.encodeState(S); }
+
   void
   notifyInstructionIssued(const InstRef &IR,
                           llvm::ArrayRef<std::pair<ResourceRef, double>> Used);
@@ -19,32 +19,62 @@
 #include "InstrBuilder.h"
 #include "SourceMgr.h"
 #include "Stages/Stage.h"
-#include <map>
+#include <vector>
 
 namespace mca {
 
 class FetchStage final : public Stage {
   std::unique_ptr<Instruction> CurrentInstruction;
-  using InstMap = std::map<unsigned, std::unique_ptr<Instruction>>;
-  InstMap Instructions;
+
+  // Instructions that have been fetched but not retired yet. Instructions are
+  // fetched and retired in program order, so this is a circular buffer
+  // indexed by source index. The size of the buffer is always a power of two,
+  // and it grows on demand.
+  std::vector<std::unique_ptr<Instruction>> Window;
+  // Source index of the oldest instruction in the window.
+  unsigned WindowStart;
+  // Number of instructions in the window.
+  unsigned WindowSize;
+
   InstrBuilder &IB;
   SourceMgr &SM;
 
   // Updates the program counter, and sets 'CurrentInstruction'.
   llvm::Error getNextInstruction();
 
+  // Appends an instruction to the window.
+  void addToWindow(unsigned SourceIndex, std::unique_ptr<Instruction> IS);
+
+  std::unique_ptr<Instruction> &getWindowEntry(unsigned SourceIndex) {
+    return Window[SourceIndex & (Window.size() - 1)];
+  }
+  const Instruction &getWindowEntry(unsigned SourceIndex) const {
+    return *Window[SourceIndex & (Window.size() - 1)];
+  }
+
   FetchStage(const FetchStage &Other) = delete;
   FetchStage &operator=(const FetchStage &Other) = delete;
 
 public:
   FetchStage(InstrBuilder &IB, SourceMgr &SM)
-      : CurrentInstruction(), IB(IB), SM(SM) {}
+      : CurrentInstruction(), WindowStart(0), WindowSize(0), IB(IB), SM(SM) {}
+  ~FetchStage();
+
+  llvm::StringRef getName() const override { return "FetchStage"; }
+
+  // Returns the number of instructions fetched and not retired yet.
+  unsigned getWindowOccupancy() const { return WindowSize; }
 
   bool isAvailable(const InstRef &IR) const override;
   bool hasWorkToComplete() const override;
   llvm::Error execute(InstRef &IR) override;
   llvm::Error cycleStart() override;
   llvm::Error cycleEnd() override;
+  unsigned getNumIdleCycles() const override;
+
+  // Encodes the program counter, and the state of every instruction in the
+  // window. This includes dependencies between register operands.
+  void encodeState(StateSignature &S) const override;
 };
 
 } // namespace mca
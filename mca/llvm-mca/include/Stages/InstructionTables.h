@@ -34,6 +34,8 @@ public:
   InstructionTables(const llvm::MCSchedModel &Model, InstrBuilder &Builder)
       : Stage(), SM(Model), IB(Builder) {}
 
+  llvm::StringRef getName() const override { return "InstructionTables"; }
+
   bool hasWorkToComplete() const override { return false; }
   llvm::Error execute(InstRef &IR) override;
 };
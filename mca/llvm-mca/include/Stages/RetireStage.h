@@ -35,9 +35,12 @@ public:
   RetireStage(RetireControlUnit &R, RegisterFile &F)
       : Stage(), RCU(R), PRF(F) {}
 
+  llvm::StringRef getName() const override { return "RetireStage"; }
+
   bool hasWorkToComplete() const override { return !RCU.isEmpty(); }
   llvm::Error cycleStart() override;
   llvm::Error execute(InstRef &IR) override;
+  unsigned getNumIdleCycles() const override;
   void notifyInstructionRetired(const InstRef &IR);
 };
 
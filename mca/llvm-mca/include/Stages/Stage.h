@@ -17,27 +17,56 @@
 #define LLVM_TOOLS_LLVM_MCA_STAGE_H
 
 #include "HWEventListener.h"
+#include "PipelineProfiler.h"
 #include "llvm/Support/Error.h"
-#include <set>
 
 namespace mca {
 
 class InstRef;
+class StateSignature;
 
 class Stage {
   Stage *NextInSequence;
-  std::set<HWEventListener *> Listeners;
+  HWEventListenerTable Listeners;
+  // Null unless profiling is enabled.
+  PipelineProfiler *Profiler;
+  // The index of the counter of this stage in Profiler.
+  unsigned ProfileIndex;
 
   Stage(const Stage &Other) = delete;
   Stage &operator=(const Stage &Other) = delete;
 
+  llvm::Error moveToTheNextStageProfiled(InstRef &IR);
+
 protected:
-  const std::set<HWEventListener *> &getListeners() const { return Listeners; }
+  using EventKind = HWEventListener::EventKind;
+
+  /// Returns the listeners subscribed to events of kind K.
+  llvm::ArrayRef<HWEventListener *> getListeners(EventKind K) const {
+    return Listeners.get(K);
+  }
+
+  /// Returns true if at least one listener is subscribed to events of kind K.
+  /// Stages use this to avoid computing the payload of unobserved events.
+  bool hasListeners(EventKind K) const { return Listeners.has(K); }
+
+  PipelineProfiler *getProfiler() const { return Profiler; }
 
 public:
-  Stage() : NextInSequence(nullptr) {}
+  Stage() : NextInSequence(nullptr), Profiler(nullptr), ProfileIndex(0) {}
   virtual ~Stage();
 
+  /// Returns the name of this stage, which is used in profile reports.
+  virtual llvm::StringRef getName() const = 0;
+
+  /// Enables profiling. The time spent in this stage is charged to counter
+  /// Index of P. Stages that own hardware units can forward P to them.
+  virtual void setProfiler(PipelineProfiler *P, unsigned Index) {
+    Profiler = P;
+    ProfileIndex = Index;
+  }
+  unsigned getProfileIndex() const { return ProfileIndex; }
+
   /// Returns true if it can execute IR during this cycle.
   virtual bool isAvailable(const InstRef &IR) const { return true; }
 
@@ -51,6 +80,27 @@ public:
   /// Called once at the end of each cycle.
   virtual llvm::Error cycleEnd() { return llvm::ErrorSuccess(); }
 
+  /// Returns the number of upcoming cycles in which this stage is guaranteed
+  /// to not change state, nor to notify events other than stalls.
+  ///
+  /// A return value of zero means that this stage may have work to do in the
+  /// next cycle. Stages that only react to events generated by other stages
+  /// return UNBOUNDED_IDLE_CYCLES (see Instruction.h).
+  virtual unsigned getNumIdleCycles() const { return 0; }
+
+  /// Advances the internal state of this stage by NumCycles idle cycles.
+  ///
+  /// This is only called by the pipeline when NumCycles is not bigger than the
+  /// value returned by method `getNumIdleCycles()`. In those cycles, methods
+  /// `cycleStart()` and `cycleEnd()` are not invoked.
+  virtual void skipCycles(unsigned NumCycles) {}
+
+  /// Appends to S the internal state of this stage that can affect future
+  /// cycles (see class StateSignature). This is used by the pipeline to detect
+  /// when the simulation becomes periodic. Hardware units shared by multiple
+  /// stages are encoded by only one of them.
+  virtual void encodeState(StateSignature &S) const {}
+
   /// The primary action that this stage performs on instruction IR.
   virtual llvm::Error execute(InstRef &IR) = 0;
 
@@ -69,6 +119,8 @@ public:
   /// successor stages.
   llvm::Error moveToTheNextStage(InstRef &IR) {
     assert(checkNextStage(IR) && "Next stage is not ready!");
+    if (LLVM_UNLIKELY(Profiler))
+      return moveToTheNextStageProfiled(IR);
     return NextInSequence->execute(IR);
   }
 
@@ -77,8 +129,9 @@ public:
 
   /// Notify listeners of a particular hardware event.
   template <typename EventT> void notifyEvent(const EventT &Event) const {
-    for (HWEventListener *Listener : Listeners)
-      Listener->onEvent(Event);
+    auto Notify = [&](HWEventListener &Listener) { Listener.onEvent(Event); };
+    notifyListeners(getListeners(HWEventListener::getEventKind(Event)),
+                    Profiler, Notify);
   }
 };
 
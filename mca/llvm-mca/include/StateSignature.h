@@ -0,0 +1,58 @@
+//===--------------------- StateSignature.h ---------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file defines class StateSignature, which is used by the Pipeline to
+/// detect when the simulation of a code region reaches a steady state.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLVM_MCA_STATESIGNATURE_H
+#define LLVM_TOOLS_LLVM_MCA_STATESIGNATURE_H
+
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallVector.h"
+#include <cstdint>
+
+namespace mca {
+
+/// An encoding of the simulated hardware state at an iteration boundary.
+///
+/// Stages and hardware units append every value that can affect the outcome
+/// of future cycles. Source indices are encoded relative to the first
+/// instruction of the current iteration, and cycles are encoded relative to
+/// the current cycle. That way, two signatures taken at different iterations
+/// compare equal if the simulation evolves in the same way from both points.
+class StateSignature {
+  // Source index of the first instruction of the current iteration.
+  const unsigned BaseIndex;
+  llvm::SmallVector<uint64_t, 128> Data;
+
+public:
+  StateSignature(unsigned Base) : BaseIndex(Base) {}
+
+  void add(uint64_t Value) { Data.push_back(Value); }
+  void addIndex(unsigned SourceIndex) {
+    add(static_cast<int64_t>(SourceIndex) - static_cast<int64_t>(BaseIndex));
+  }
+
+  unsigned getBaseIndex() const { return BaseIndex; }
+
+  llvm::hash_code hash() const {
+    return llvm::hash_combine_range(Data.begin(), Data.end());
+  }
+
+  bool operator==(const StateSignature &Other) const {
+    return Data == Other.Data;
+  }
+};
+
+} // namespace mca
+
+#endif // LLVM_TOOLS_LLVM_MCA_STATESIGNATURE_H
@@ -0,0 +1,417 @@
+//===--------------------- PipelineBenchmark.cpp ----------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements llvm-mca-bench, a benchmark of the throughput of the
+/// simulator itself. It runs the default pipeline on a set of representative
+/// x86 kernels, for a few scheduling models, and reports the number of
+/// simulated cycles and instructions per second of Pipeline::run().
+///
+/// Options -event-driven, -extrapolate and -views select the configuration of
+/// the simulation, so that the same kernels can be measured with and without
+/// idle cycle skipping, steady-state extrapolation, and the views of the tool.
+/// When views are enabled, the measurements also include producing the
+/// report, which is printed to a null stream.
+///
+/// Every kernel is simulated once before being measured, so that instruction
+/// descriptors are built outside of the measurements. Every measurement is
+/// then repeated, and both the fastest and the median run are reported. The
+/// simulation is deterministic, so every repetition must simulate the same
+/// number of cycles; a mismatch is reported as an error.
+///
+//===----------------------------------------------------------------------===//
+
+#include "Context.h"
+#include "InstrBuilder.h"
+#include "Pipeline.h"
+#include "PipelinePrinter.h"
+#include "SourceMgr.h"
+#include "Views/InstructionInfoView.h"
+#include "Views/ResourcePressureView.h"
+#include "Views/SummaryView.h"
+#include "llvm/MC/MCAsmInfo.h"
+#include "llvm/MC/MCContext.h"
+#include "llvm/MC/MCInstPrinter.h"
+#include "llvm/MC/MCInstrAnalysis.h"
+#include "llvm/MC/MCInstrInfo.h"
+#include "llvm/MC/MCObjectFileInfo.h"
+#include "llvm/MC/MCParser/MCAsmParser.h"
+#include "llvm/MC/MCParser/MCTargetAsmParser.h"
+#include "llvm/MC/MCRegisterInfo.h"
+#include "llvm/MC/MCStreamer.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/WithColor.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static cl::OptionCategory BenchOptions("Benchmark Options");
+
+static cl::list<std::string>
+    CPUs("mcpu", cl::desc("Comma separated list of cpus to benchmark"),
+         cl::value_desc("cpu-names"), cl::CommaSeparated,
+         cl::cat(BenchOptions));
+
+static cl::list<std::string>
+    KernelNames("kernel",
+                cl::desc("Comma separated list of kernels to benchmark "
+                         "(dep-chain, port-mix, memory, large-window)"),
+                cl::value_desc("kernel-names"), cl::CommaSeparated,
+                cl::cat(BenchOptions));
+
+static cl::opt<unsigned>
+    Iterations("iterations",
+               cl::desc("Number of iterations of every kernel to simulate"),
+               cl::cat(BenchOptions), cl::init(10000));
+
+static cl::opt<unsigned>
+    Repetitions("repetitions",
+                cl::desc("Number of measurements of every simulation"),
+                cl::cat(BenchOptions), cl::init(5));
+
+static cl::opt<bool>
+    EventDriven("event-driven",
+                cl::desc("Skip idle cycles instead of simulating them one "
+                         "by one"),
+                cl::cat(BenchOptions), cl::init(false));
+
+static cl::opt<bool>
+    Extrapolate("extrapolate",
+                cl::desc("Extrapolate the simulation once it reaches a "
+                         "steady state"),
+                cl::cat(BenchOptions), cl::init(false));
+
+namespace {
+enum class ViewSet { None, Default, SummaryOnly };
+} // end of anonymous namespace
+
+static cl::opt<ViewSet> Views(
+    "views", cl::desc("Views attached to the pipeline"),
+    cl::values(clEnumValN(ViewSet::None, "none",
+                          "No views (default): only time Pipeline::run()"),
+               clEnumValN(ViewSet::Default, "default",
+                          "The default views of llvm-mca"),
+               clEnumValN(ViewSet::SummaryOnly, "summary-only",
+                          "The summary view only, as in llvm-mca "
+                          "-summary-only")),
+    cl::cat(BenchOptions), cl::init(ViewSet::None));
+
+static const char *const TripleName = "x86_64-unknown-unknown";
+
+// The cpus benchmarked by default. They cover a small, a big core, and a
+// scheduling model with many resource groups.
+static const char *const DefaultCPUs[] = {"btver2", "haswell", "znver1"};
+
+namespace {
+
+using InstVec = std::vector<std::unique_ptr<const MCInst>>;
+
+struct Kernel {
+  std::string Name;
+  std::string Assembly;
+};
+
+// Returns the kernels of the benchmark.
+std::vector<Kernel> getKernels() {
+  std::vector<Kernel> Kernels;
+
+  // A serial dependency chain through the integer ALU and the multiplier.
+  // Most of the time is spent waiting for operands.
+  Kernels.push_back({"dep-chain", "addq %rax, %rbx\n"
+                                  "imulq %rbx, %rcx\n"
+                                  "addq %rcx, %rdx\n"
+                                  "imulq %rdx, %rsi\n"
+                                  "addq %rsi, %rdi\n"
+                                  "imulq %rdi, %rax\n"});
+
+  // Independent integer and vector operations competing for the same
+  // execution ports. Most of the time is spent selecting pipes.
+  Kernels.push_back({"port-mix", "vaddps %xmm0, %xmm1, %xmm2\n"
+                                 "vmulps %xmm3, %xmm4, %xmm5\n"
+                                 "vpaddd %xmm6, %xmm7, %xmm8\n"
+                                 "vpshufb %xmm9, %xmm10, %xmm11\n"
+                                 "vxorps %xmm12, %xmm13, %xmm14\n"
+                                 "addq %r8, %r9\n"
+                                 "shlq $3, %r10\n"
+                                 "andq %r11, %r12\n"});
+
+  // Loads, stores and folded memory operands, which go through the load/store
+  // unit.
+  Kernels.push_back({"memory", "movq (%rdi), %rax\n"
+                               "addq 8(%rdi), %rax\n"
+                               "movq %rax, (%rsi)\n"
+                               "movq 16(%rdi), %rbx\n"
+                               "vmovaps (%rdx), %xmm0\n"
+                               "vaddps 16(%rdx), %xmm0, %xmm1\n"
+                               "vmovaps %xmm1, (%rcx)\n"
+                               "incq 24(%rsi)\n"});
+
+  // Long latency divisions followed by many independent instructions, which
+  // fill the reorder buffer and the scheduler queues.
+  std::string LargeWindow = "divq %rcx\n"
+                            "vsqrtpd %xmm0, %xmm0\n";
+  for (unsigned I = 0; I < 64; ++I) {
+    LargeWindow += (I % 2 ? "movq " : "leaq ") + std::to_string(8 * I) +
+                   "(%rsi), %r" + std::to_string(8 + I % 8) + '\n';
+  }
+  Kernels.push_back({"large-window", LargeWindow});
+  return Kernels;
+}
+
+// A streamer that collects the instructions of a kernel.
+class InstructionCollector final : public MCStreamer {
+  InstVec &Insts;
+
+public:
+  InstructionCollector(MCContext &Context, InstVec &I)
+      : MCStreamer(Context), Insts(I) {}
+
+  void EmitInstruction(const MCInst &Inst, const MCSubtargetInfo &STI,
+                       bool /* unused */) override {
+    Insts.emplace_back(llvm::make_unique<const MCInst>(Inst));
+  }
+
+  bool EmitSymbolAttribute(MCSymbol *Symbol, MCSymbolAttr Attribute) override {
+    return true;
+  }
+  void EmitCommonSymbol(MCSymbol *Symbol, uint64_t Size,
+                        unsigned ByteAlignment) override {}
+  void EmitZerofill(MCSection *Section, MCSymbol *Symbol = nullptr,
+                    uint64_t Size = 0, unsigned ByteAlignment = 0,
+                    SMLoc Loc = SMLoc()) override {}
+};
+
+// The target description objects shared by every cpu.
+struct TargetObjects {
+  const Target *TheTarget;
+  std::unique_ptr<MCRegisterInfo> MRI;
+  std::unique_ptr<MCAsmInfo> MAI;
+  std::unique_ptr<MCInstrInfo> MCII;
+  std::unique_ptr<MCInstrAnalysis> MCIA;
+};
+
+// The outcome of one simulation.
+struct Measurement {
+  unsigned Cycles;
+  unsigned Instructions;
+  double Seconds;
+};
+} // end of anonymous namespace
+
+// Assembles Assembly for subtarget STI, and appends its instructions to
+// Insts. Returns false on error.
+static bool assembleKernel(StringRef Assembly, const TargetObjects &T,
+                           const MCSubtargetInfo &STI, InstVec &Insts) {
+  SourceMgr SrcMgr;
+  SrcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(Assembly), SMLoc());
+
+  MCObjectFileInfo MOFI;
+  MCContext Ctx(T.MAI.get(), T.MRI.get(), &MOFI, &SrcMgr);
+  MOFI.InitMCObjectFileInfo(Triple(TripleName), /* PIC= */ false, Ctx);
+
+  InstructionCollector Str(Ctx, Insts);
+  std::unique_ptr<MCAsmParser> P(createMCAsmParser(SrcMgr, Ctx, Str, *T.MAI));
+  MCTargetOptions MCOptions;
+  std::unique_ptr<MCTargetAsmParser> TAP(
+      T.TheTarget->createMCAsmParser(STI, *P, *T.MCII, MCOptions));
+  if (!TAP)
+    return false;
+
+  P->setTargetParser(*TAP);
+  return !P->Run(false) && !Insts.empty();
+}
+
+// Simulates Iterations iterations of Insts with the default pipeline, and
+// measures the time spent in Pipeline::run(). If views are enabled, they are
+// attached to the pipeline the same way llvm-mca does, and the time spent
+// producing the report is measured as well.
+static Expected<Measurement> simulate(const TargetObjects &T,
+                                      const MCSubtargetInfo &STI,
+                                      mca::InstrBuilder &IB, MCInstPrinter &IP,
+                                      const InstVec &Insts) {
+  mca::Context MCA(*T.MRI, STI);
+  mca::SourceMgr S(Insts, Iterations);
+  mca::PipelineOptions PO(STI.getSchedModel().IssueWidth,
+                          /* RegisterFileSize */ 0, /* LoadQueueSize */ 0,
+                          /* StoreQueueSize */ 0, /* AssumeNoAlias */ true,
+                          EventDriven, Extrapolate);
+  auto P = MCA.createDefaultPipeline(PO, IB, S);
+  mca::PipelinePrinter Printer(*P);
+  if (Views == ViewSet::Default) {
+    Printer.addView(llvm::make_unique<mca::SummaryView>(
+        STI.getSchedModel(), S, PO.DispatchWidth));
+    Printer.addView(
+        llvm::make_unique<mca::InstructionInfoView>(STI, *T.MCII, S, IP));
+    Printer.addView(llvm::make_unique<mca::ResourcePressureView>(STI, IP, S));
+  }
+
+  raw_null_ostream NullOS;
+  auto Start = std::chrono::steady_clock::now();
+  if (Error Err = P->run())
+    return std::move(Err);
+  if (Views == ViewSet::SummaryOnly) {
+    // Same as llvm-mca -summary-only: the summary is computed from the
+    // descriptors of one iteration, and from the number of simulated cycles.
+    auto SV = llvm::make_unique<mca::SummaryView>(STI.getSchedModel(), S,
+                                                  PO.DispatchWidth);
+    for (const std::unique_ptr<const MCInst> &MCI : Insts) {
+      Expected<const mca::InstrDesc &> Desc = IB.getOrCreateInstrDesc(*MCI);
+      if (!Desc)
+        return Desc.takeError();
+      SV->addBlockInstruction(*Desc);
+    }
+    SV->setTotalCycles(P->getNumCycles());
+    Printer.addView(std::move(SV));
+  }
+  Printer.printReport(NullOS);
+  auto End = std::chrono::steady_clock::now();
+  IB.clear();
+
+  Measurement M;
+  M.Cycles = P->getNumCycles();
+  M.Instructions = S.size() * S.getNumIterations();
+  M.Seconds = std::chrono::duration<double>(End - Start).count();
+  return M;
+}
+
+// Benchmarks every selected kernel on CPU. Returns false on error.
+static bool benchmarkCPU(StringRef CPU, const TargetObjects &T,
+                         ArrayRef<Kernel> Kernels, raw_ostream &OS) {
+  std::unique_ptr<MCSubtargetInfo> STI(
+      T.TheTarget->createMCSubtargetInfo(TripleName, CPU, ""));
+  if (!STI->isCPUStringValid(CPU) ||
+      !STI->getSchedModel().hasInstrSchedModel() ||
+      !STI->getSchedModel().isOutOfOrder()) {
+    WithColor::error() << "'" << CPU
+                       << "' is not an out-of-order cpu with a scheduling "
+                          "model.\n";
+    return false;
+  }
+
+  std::unique_ptr<MCInstPrinter> IP(T.TheTarget->createMCInstPrinter(
+      Triple(TripleName), 0, *T.MAI, *T.MCII, *T.MRI));
+  mca::InstrBuilder IB(*STI, *T.MCII, *T.MRI, *T.MCIA, *IP);
+
+  for (const Kernel &K : Kernels) {
+    InstVec Insts;
+    if (!assembleKernel(K.Assembly, T, *STI, Insts)) {
+      WithColor::error() << "unable to assemble kernel '" << K.Name
+                         << "' for cpu '" << CPU << "'.\n";
+      return false;
+    }
+
+    // Warm up, and check that every repetition simulates the same cycles.
+    Expected<Measurement> Reference = simulate(T, *STI, IB, *IP, Insts);
+    if (!Reference) {
+      WithColor::error() << toString(Reference.takeError()) << '\n';
+      return false;
+    }
+
+    std::vector<double> Seconds;
+    for (unsigned I = 0; I < Repetitions; ++I) {
+      Expected<Measurement> M = simulate(T, *STI, IB, *IP, Insts);
+      if (!M) {
+        WithColor::error() << toString(M.takeError()) << '\n';
+        return false;
+      }
+      if (M->Cycles != Reference->Cycles) {
+        WithColor::error() << "non deterministic simulation of kernel '"
+                           << K.Name << "' on cpu '" << CPU << "'.\n";
+        return false;
+      }
+      Seconds.push_back(M->Seconds);
+    }
+
+    std::sort(Seconds.begin(), Seconds.end());
+    double Min = Seconds.front();
+    double Median = Seconds[Seconds.size() / 2];
+    OS << format("%-10s %-13s %10u %10u %9.3f %9.3f %10.3f %10.3f\n",
+                 CPU.str().c_str(), K.Name.c_str(), Reference->Cycles,
+                 Reference->Instructions, Min * 1000, Median * 1000,
+                 Reference->Cycles / Median / 1e6,
+                 Reference->Instructions / Median / 1e6);
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
+
+  llvm::InitializeAllTargetInfos();
+  llvm::InitializeAllTargetMCs();
+  llvm::InitializeAllAsmParsers();
+
+  cl::HideUnrelatedOptions(BenchOptions);
+  cl::ParseCommandLineOptions(argc, argv,
+                              "llvm-mca simulator throughput benchmark\n");
+
+  if (!Repetitions) {
+    WithColor::error() << "-repetitions must be at least 1.\n";
+    return 1;
+  }
+
+  TargetObjects T;
+  std::string Error;
+  T.TheTarget = TargetRegistry::lookupTarget(TripleName, Error);
+  if (!T.TheTarget) {
+    WithColor::error() << Error << '\n';
+    return 1;
+  }
+
+  T.MRI.reset(T.TheTarget->createMCRegInfo(TripleName));
+  T.MAI.reset(T.TheTarget->createMCAsmInfo(*T.MRI, TripleName));
+  T.MCII.reset(T.TheTarget->createMCInstrInfo());
+  T.MCIA.reset(T.TheTarget->createMCInstrAnalysis(T.MCII.get()));
+
+  std::vector<Kernel> Kernels = getKernels();
+  if (!KernelNames.empty()) {
+    for (const std::string &Name : KernelNames) {
+      if (none_of(Kernels, [&](const Kernel &K) { return K.Name == Name; })) {
+        WithColor::error() << "unknown kernel '" << Name << "'.\n";
+        return 1;
+      }
+    }
+    Kernels.erase(remove_if(Kernels,
+                            [](const Kernel &K) {
+                              return !is_contained(KernelNames, K.Name);
+                            }),
+                  Kernels.end());
+  }
+
+  std::vector<std::string> CPUList(CPUs.begin(), CPUs.end());
+  if (CPUList.empty())
+    CPUList.assign(std::begin(DefaultCPUs), std::end(DefaultCPUs));
+
+  raw_ostream &OS = outs();
+  static const char *const ViewSetNames[] = {"none", "default",
+                                             "summary-only"};
+  OS << "Iterations: " << Iterations << ", repetitions: " << Repetitions
+     << ", event-driven: " << (EventDriven ? "yes" : "no")
+     << ", extrapolate: " << (Extrapolate ? "yes" : "no")
+     << ", views: " << ViewSetNames[static_cast<unsigned>(Views.getValue())]
+     << "\n\n";
+  OS << "CPU        Kernel            Cycles      Insts   Min(ms)   Med(ms)"
+        "  MCycles/s   MInsts/s\n";
+  for (const std::string &CPU : CPUList) {
+    if (!benchmarkCPU(CPU, T, Kernels, OS))
+      return 1;
+  }
+  return 0;
+}
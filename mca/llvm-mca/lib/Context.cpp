@@ -54,11 +54,13 @@ Context::createDefaultPipeline(const PipelineOptions &Opts, InstrBuilder &IB,
   addHardwareUnit(std::move(HWS));
 
   // Build the pipeline.
-  auto StagePipeline = llvm::make_unique<Pipeline>();
+  auto StagePipeline = llvm::make_unique<Pipeline>(Opts.SkipIdleCycles);
   StagePipeline->appendStage(std::move(Fetch));
   StagePipeline->appendStage(std::move(Dispatch));
   StagePipeline->appendStage(std::move(Execute));
   StagePipeline->appendStage(std::move(Retire));
+  if (Opts.ExtrapolateSteadyState)
+    StagePipeline->enableSteadyStateExtrapolation(SrcMgr);
   return StagePipeline;
 }
 
@@ -14,7 +14,9 @@
 
 #include "HardwareUnits/LSUnit.h"
 #include "Instruction.h"
+#include "StateSignature.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -23,6 +25,60 @@ using namespace llvm;
 
 namespace mca {
 
+void MemoryQueue::grow(unsigned MinCapacity) {
+  unsigned NumWords = Bits.size();
+  while (NumWords * 64 < MinCapacity)
+    NumWords *= 2;
+
+  // Rehash the entries that are still in the queue.
+  SmallVector<uint64_t, 4> NewBits(NumWords);
+  for (unsigned I = Oldest; I <= Youngest; ++I)
+    if (test(I))
+      NewBits[(I / 64) & (NumWords - 1)] |= UINT64_C(1) << (I % 64);
+  Bits = std::move(NewBits);
+}
+
+void MemoryQueue::insert(unsigned Index) {
+  assert((empty() || Index > Youngest) && "Entries must be in program order!");
+  if (empty())
+    Oldest = Index;
+  else if (Index - Oldest >= getCapacity())
+    grow(Index - Oldest + 1);
+
+  getWord(Index) |= UINT64_C(1) << (Index % 64);
+  Youngest = Index;
+  ++NumEntries;
+}
+
+void MemoryQueue::erase(unsigned Index) {
+  assert(count(Index) && "Entry not in queue!");
+  getWord(Index) &= ~(UINT64_C(1) << (Index % 64));
+  --NumEntries;
+  if (empty() || Index != Oldest)
+    return;
+
+  // Find the next oldest entry. Bits outside of the range of live entries are
+  // always clear, so the search stops at the first bit set.
+  unsigned I = Index + 1;
+  for (;;) {
+    uint64_t Word = getWord(I) >> (I % 64);
+    if (Word) {
+      Oldest = I + countTrailingZeros(Word);
+      return;
+    }
+    I = (I | 63) + 1;
+  }
+}
+
+void MemoryQueue::encodeState(StateSignature &S) const {
+  S.add(NumEntries);
+  if (empty())
+    return;
+  for (unsigned I = Oldest; I <= Youngest; ++I)
+    if (test(I))
+      S.addIndex(I);
+}
+
 #ifndef NDEBUG
 void LSUnit::dump() const {
   dbgs() << "[LSUnit] LQ_Size = " << LQ_Size << '\n';
@@ -88,18 +144,18 @@ bool LSUnit::isReady(const InstRef &IR) const {
   assert((!IsAStore || StoreQueue.count(Index) == 1) && "Store not in queue!");
 
   if (IsALoad && !LoadBarriers.empty()) {
-    unsigned LoadBarrierIndex = *LoadBarriers.begin();
+    unsigned LoadBarrierIndex = LoadBarriers.front();
     if (Index > LoadBarrierIndex)
       return false;
-    if (Index == LoadBarrierIndex && Index != *LoadQueue.begin())
+    if (Index == LoadBarrierIndex && Index != LoadQueue.front())
       return false;
   }
 
   if (IsAStore && !StoreBarriers.empty()) {
-    unsigned StoreBarrierIndex = *StoreBarriers.begin();
+    unsigned StoreBarrierIndex = StoreBarriers.front();
     if (Index > StoreBarrierIndex)
       return false;
-    if (Index == StoreBarrierIndex && Index != *StoreQueue.begin())
+    if (Index == StoreBarrierIndex && Index != StoreQueue.front())
       return false;
   }
 
@@ -108,7 +164,7 @@ bool LSUnit::isReady(const InstRef &IR) const {
 
   if (StoreQueue.size()) {
     // Check if this memory operation is younger than the older store.
-    if (Index > *StoreQueue.begin())
+    if (Index > StoreQueue.front())
       return false;
   }
 
@@ -119,7 +175,7 @@ bool LSUnit::isReady(const InstRef &IR) const {
     return true;
 
   // Check if there are no older loads.
-  if (Index <= *LoadQueue.begin())
+  if (Index <= LoadQueue.front())
     return true;
 
   // There is at least one younger load.
@@ -128,29 +184,34 @@ bool LSUnit::isReady(const InstRef &IR) const {
 
 void LSUnit::onInstructionExecuted(const InstRef &IR) {
   const unsigned Index = IR.getSourceIndex();
-  std::set<unsigned>::iterator it = LoadQueue.find(Index);
-  if (it != LoadQueue.end()) {
+  if (LoadQueue.count(Index)) {
     LLVM_DEBUG(dbgs() << "[LSUnit]: Instruction idx=" << Index
                       << " has been removed from the load queue.\n");
-    LoadQueue.erase(it);
+    LoadQueue.erase(Index);
   }
 
-  it = StoreQueue.find(Index);
-  if (it != StoreQueue.end()) {
+  if (StoreQueue.count(Index)) {
     LLVM_DEBUG(dbgs() << "[LSUnit]: Instruction idx=" << Index
                       << " has been removed from the store queue.\n");
-    StoreQueue.erase(it);
+    StoreQueue.erase(Index);
   }
 
-  if (!StoreBarriers.empty() && Index == *StoreBarriers.begin()) {
+  if (!StoreBarriers.empty() && Index == StoreBarriers.front()) {
     LLVM_DEBUG(dbgs() << "[LSUnit]: Instruction idx=" << Index
                       << " has been removed from the set of store barriers.\n");
-    StoreBarriers.erase(StoreBarriers.begin());
+    StoreBarriers.erase(Index);
   }
-  if (!LoadBarriers.empty() && Index == *LoadBarriers.begin()) {
+  if (!LoadBarriers.empty() && Index == LoadBarriers.front()) {
     LLVM_DEBUG(dbgs() << "[LSUnit]: Instruction idx=" << Index
                       << " has been removed from the set of load barriers.\n");
-    LoadBarriers.erase(LoadBarriers.begin());
+    LoadBarriers.erase(Index);
   }
 }
+
+void LSUnit::encodeState(StateSignature &S) const {
+  LoadQueue.encodeState(S);
+  StoreQueue.encodeState(S);
+  LoadBarriers.encodeState(S);
+  StoreBarriers.encodeState(S);
+}
 } // namespace mca
@@ -16,6 +16,7 @@
 
 #include "HardwareUnits/RegisterFile.h"
 #include "Instruction.h"
+#include "StateSignature.h"
 #include "llvm/Support/Debug.h"
 
 using namespace llvm;
@@ -24,10 +25,28 @@ using namespace llvm;
 
 namespace mca {
 
+template <typename IteratorT>
+void RegisterFile::RegisterAliasTable::initialize(const MCRegisterInfo &MRI) {
+  unsigned NumRegs = MRI.getNumRegs();
+  Begin.reserve(NumRegs + 1);
+  for (unsigned RegID = 0; RegID < NumRegs; ++RegID) {
+    Begin.push_back(Aliases.size());
+    // Register #0 is the invalid register, which has no aliases.
+    if (!RegID)
+      continue;
+    for (IteratorT I(RegID, &MRI); I.isValid(); ++I)
+      Aliases.push_back(*I);
+  }
+  Begin.push_back(Aliases.size());
+}
+
 RegisterFile::RegisterFile(const llvm::MCSchedModel &SM,
                            const llvm::MCRegisterInfo &mri, unsigned NumRegs)
     : MRI(mri), RegisterMappings(mri.getNumRegs(),
-                                 {WriteRef(), {IndexPlusCostPairTy(0, 1), 0}}) {
+                                 {WriteRef(), {IndexPlusCostPairTy(0, 1), 0}}),
+      CollectGeneration(0), PhysRegsGeneration(0) {
+  SubRegs.initialize<MCSubRegIterator>(MRI);
+  SuperRegs.initialize<MCSuperRegIterator>(MRI);
   initialize(SM, NumRegs);
 }
 
@@ -95,11 +114,11 @@ void RegisterFile::addRegisterFile(ArrayRef<MCRegisterCostEntry> Entries,
       Entry.RenameAs = Reg;
 
       // Assume the same cost for each sub-register.
-      for (MCSubRegIterator I(Reg, &MRI); I.isValid(); ++I) {
-        RegisterRenamingInfo &OtherEntry = RegisterMappings[*I].second;
+      for (const MCPhysReg SubReg : SubRegs.get(Reg)) {
+        RegisterRenamingInfo &OtherEntry = RegisterMappings[SubReg].second;
         if (!OtherEntry.IndexPlusCost.first &&
             (!OtherEntry.RenameAs ||
-             MRI.isSuperRegister(*I, OtherEntry.RenameAs))) {
+             MRI.isSuperRegister(SubReg, OtherEntry.RenameAs))) {
           OtherEntry.IndexPlusCost = IPC;
           OtherEntry.RenameAs = Reg;
         }
@@ -110,6 +129,7 @@ void RegisterFile::addRegisterFile(ArrayRef<MCRegisterCostEntry> Entries,
 
 void RegisterFile::allocatePhysRegs(const RegisterRenamingInfo &Entry,
                                     MutableArrayRef<unsigned> UsedPhysRegs) {
+  ++PhysRegsGeneration;
   unsigned RegisterFileIndex = Entry.IndexPlusCost.first;
   unsigned Cost = Entry.IndexPlusCost.second;
   if (RegisterFileIndex) {
@@ -125,6 +145,7 @@ void RegisterFile::allocatePhysRegs(const RegisterRenamingInfo &Entry,
 
 void RegisterFile::freePhysRegs(const RegisterRenamingInfo &Entry,
                                 MutableArrayRef<unsigned> FreedPhysRegs) {
+  ++PhysRegsGeneration;
   unsigned RegisterFileIndex = Entry.IndexPlusCost.first;
   unsigned Cost = Entry.IndexPlusCost.second;
   if (RegisterFileIndex) {
@@ -184,8 +205,8 @@ void RegisterFile::addRegisterWrite(WriteRef Write,
 
   // Update the mapping for register RegID including its sub-registers.
   RegisterMappings[RegID].first = Write;
-  for (MCSubRegIterator I(RegID, &MRI); I.isValid(); ++I)
-    RegisterMappings[*I].first = Write;
+  for (const MCPhysReg SubReg : SubRegs.get(RegID))
+    RegisterMappings[SubReg].first = Write;
 
   // No physical registers are allocated for instructions that are optimized in
   // hardware. For example, zero-latency data-dependency breaking instructions
@@ -196,8 +217,8 @@ void RegisterFile::addRegisterWrite(WriteRef Write,
   if (!WS.clearsSuperRegisters())
     return;
 
-  for (MCSuperRegIterator I(RegID, &MRI); I.isValid(); ++I)
-    RegisterMappings[*I].first = Write;
+  for (const MCPhysReg SuperReg : SuperRegs.get(RegID))
+    RegisterMappings[SuperReg].first = Write;
 }
 
 void RegisterFile::removeRegisterWrite(const WriteState &WS,
@@ -227,8 +248,8 @@ void RegisterFile::removeRegisterWrite(const WriteState &WS,
   if (WR.getWriteState() == &WS)
     WR.invalidate();
 
-  for (MCSubRegIterator I(RegID, &MRI); I.isValid(); ++I) {
-    WriteRef &OtherWR = RegisterMappings[*I].first;
+  for (const MCPhysReg SubReg : SubRegs.get(RegID)) {
+    WriteRef &OtherWR = RegisterMappings[SubReg].first;
     if (OtherWR.getWriteState() == &WS)
       OtherWR.invalidate();
   }
@@ -236,8 +257,8 @@ void RegisterFile::removeRegisterWrite(const WriteState &WS,
   if (!WS.clearsSuperRegisters())
     return;
 
-  for (MCSuperRegIterator I(RegID, &MRI); I.isValid(); ++I) {
-    WriteRef &OtherWR = RegisterMappings[*I].first;
+  for (const MCPhysReg SuperReg : SuperRegs.get(RegID)) {
+    WriteRef &OtherWR = RegisterMappings[SuperReg].first;
     if (OtherWR.getWriteState() == &WS)
       OtherWR.invalidate();
   }
@@ -248,24 +269,20 @@ void RegisterFile::collectWrites(SmallVectorImpl<WriteRef> &Writes,
   assert(RegID && RegID < RegisterMappings.size());
   LLVM_DEBUG(dbgs() << "RegisterFile: collecting writes for register "
                     << MRI.getName(RegID) << '\n');
-  const WriteRef &WR = RegisterMappings[RegID].first;
-  if (WR.isValid())
-    Writes.push_back(WR);
-
-  // Handle potential partial register updates.
-  for (MCSubRegIterator I(RegID, &MRI); I.isValid(); ++I) {
-    const WriteRef &WR = RegisterMappings[*I].first;
-    if (WR.isValid())
+  // A write may be mapped to more than one sub-register of RegID. Every write
+  // is stamped with the generation of this query, and is only collected the
+  // first time it is found.
+  uint64_t Generation = ++CollectGeneration;
+  auto Collect = [&](const WriteRef &WR) {
+    if (WR.isValid() && WR.getWriteState()->markCollected(Generation))
       Writes.push_back(WR);
-  }
+  };
+
+  Collect(RegisterMappings[RegID].first);
 
-  // Remove duplicate entries and resize the input vector.
-  llvm::sort(Writes.begin(), Writes.end(),
-             [](const WriteRef &Lhs, const WriteRef &Rhs) {
-               return Lhs.getWriteState() < Rhs.getWriteState();
-             });
-  auto It = std::unique(Writes.begin(), Writes.end());
-  Writes.resize(std::distance(Writes.begin(), It));
+  // Handle potential partial register updates.
+  for (const MCPhysReg SubReg : SubRegs.get(RegID))
+    Collect(RegisterMappings[SubReg].first);
 
   LLVM_DEBUG({
     for (const WriteRef &WR : Writes) {
@@ -277,9 +294,9 @@ void RegisterFile::collectWrites(SmallVectorImpl<WriteRef> &Writes,
   });
 }
 
-unsigned RegisterFile::isAvailable(ArrayRef<unsigned> Regs) const {
-  SmallVector<unsigned, 4> NumPhysRegs(getNumRegisterFiles());
-
+void RegisterFile::getRegisterCosts(
+    ArrayRef<unsigned> Regs, MutableArrayRef<unsigned> NumPhysRegs) const {
+  assert(NumPhysRegs.size() == getNumRegisterFiles());
   // Find how many new mappings must be created for each register file.
   for (const unsigned RegID : Regs) {
     const RegisterRenamingInfo &RRI = RegisterMappings[RegID].second;
@@ -288,7 +305,10 @@ unsigned RegisterFile::isAvailable(ArrayRef<unsigned> Regs) const {
       NumPhysRegs[Entry.first] += Entry.second;
     NumPhysRegs[0] += Entry.second;
   }
+}
 
+unsigned RegisterFile::isAvailable(ArrayRef<unsigned> NumPhysRegs) const {
+  assert(NumPhysRegs.size() == getNumRegisterFiles());
   unsigned Response = 0;
   for (unsigned I = 0, E = getNumRegisterFiles(); I < E; ++I) {
     unsigned NumRegs = NumPhysRegs[I];
@@ -324,6 +344,19 @@ unsigned RegisterFile::isAvailable(ArrayRef<unsigned> Regs) const {
   return Response;
 }
 
+void RegisterFile::encodeState(StateSignature &S) const {
+  for (unsigned I = 0, E = RegisterMappings.size(); I < E; ++I) {
+    const WriteRef &WR = RegisterMappings[I].first;
+    if (!WR.isValid())
+      continue;
+    S.add(I);
+    S.addIndex(WR.getSourceIndex());
+  }
+
+  for (const RegisterMappingTracker &RMT : RegisterFiles)
+    S.add(RMT.NumUsedPhysRegs);
+}
+
 #ifndef NDEBUG
 void RegisterFile::dump() const {
   for (unsigned I = 0, E = MRI.getNumRegs(); I < E; ++I) {
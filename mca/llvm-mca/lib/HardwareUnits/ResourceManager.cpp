@@ -14,6 +14,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "HardwareUnits/ResourceManager.h"
+#include "StateSignature.h"
 #include "Support.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
@@ -51,6 +52,11 @@ void DefaultResourceStrategy::used(uint64_t Mask) {
   skipMask(Mask);
 }
 
+void DefaultResourceStrategy::encodeState(StateSignature &S) const {
+  S.add(NextInSequenceMask);
+  S.add(RemovedFromNextInSequence);
+}
+
 ResourceState::ResourceState(const MCProcResourceDesc &Desc, unsigned Index,
                              uint64_t Mask)
     : ProcResourceDescIndex(Index), ResourceMask(Mask),
@@ -77,6 +83,12 @@ ResourceStateEvent ResourceState::isBufferAvailable() const {
   return RS_BUFFER_UNAVAILABLE;
 }
 
+void ResourceState::encodeState(StateSignature &S) const {
+  S.add(ReadyMask);
+  S.add(AvailableSlots);
+  S.add(Unavailable);
+}
+
 #ifndef NDEBUG
 void ResourceState::dump() const {
   dbgs() << "MASK: " << ResourceMask << ", SIZE_MASK: " << ResourceSizeMask
@@ -98,7 +110,8 @@ getStrategyFor(const ResourceState &RS) {
 }
 
 ResourceManager::ResourceManager(const MCSchedModel &SM)
-    : ProcResID2Mask(SM.getNumProcResourceKinds()) {
+    : CurrentCycle(0), TimingWheel(TimingWheelSize),
+      ProcResID2Mask(SM.getNumProcResourceKinds()) {
   computeProcResourceMasks(SM, ProcResID2Mask);
   Resources.resize(SM.getNumProcResourceKinds());
   Strategies.resize(SM.getNumProcResourceKinds());
@@ -110,6 +123,18 @@ ResourceManager::ResourceManager(const MCSchedModel &SM)
         llvm::make_unique<ResourceState>(*SM.getProcResource(I), I, Mask);
     Strategies[Index] = getStrategyFor(*Resources[Index]);
   }
+
+  // Compute the set of groups that contain each processor resource.
+  Resource2Groups.resize(SM.getNumProcResourceKinds());
+  for (uint64_t GroupMask : ProcResID2Mask) {
+    if (countPopulation(GroupMask) <= 1)
+      continue;
+    unsigned GroupIndex = getResourceStateIndex(GroupMask);
+    for (uint64_t Mask : ProcResID2Mask) {
+      if (countPopulation(Mask) == 1 && (GroupMask & Mask))
+        Resource2Groups[getResourceStateIndex(Mask)].push_back(GroupIndex);
+    }
+  }
 }
 
 void ResourceManager::setCustomStrategyImpl(std::unique_ptr<ResourceStrategy> S,
@@ -157,16 +182,9 @@ void ResourceManager::use(const ResourceRef &RR) {
     return;
 
   // Notify to other resources that RR.first is no longer available.
-  for (std::unique_ptr<ResourceState> &Res : Resources) {
-    ResourceState &Current = *Res;
-    if (!Current.isAResourceGroup() || Current.getResourceMask() == RR.first)
-      continue;
-
-    if (Current.containsResource(RR.first)) {
-      unsigned Index = getResourceStateIndex(Current.getResourceMask());
-      Current.markSubResourceAsUsed(RR.first);
-      Strategies[Index]->used(RR.first);
-    }
+  for (unsigned Index : Resource2Groups[getResourceStateIndex(RR.first)]) {
+    Resources[Index]->markSubResourceAsUsed(RR.first);
+    Strategies[Index]->used(RR.first);
   }
 }
 
@@ -177,14 +195,8 @@ void ResourceManager::release(const ResourceRef &RR) {
   if (!WasFullyUsed)
     return;
 
-  for (std::unique_ptr<ResourceState> &Res : Resources) {
-    ResourceState &Current = *Res;
-    if (!Current.isAResourceGroup() || Current.getResourceMask() == RR.first)
-      continue;
-
-    if (Current.containsResource(RR.first))
-      Current.releaseSubResource(RR.first);
-  }
+  for (unsigned Index : Resource2Groups[getResourceStateIndex(RR.first)])
+    Resources[Index]->releaseSubResource(RR.first);
 }
 
 ResourceStateEvent
@@ -218,13 +230,13 @@ void ResourceManager::releaseBuffers(ArrayRef<uint64_t> Buffers) {
 }
 
 bool ResourceManager::canBeIssued(const InstrDesc &Desc) const {
-  return std::all_of(Desc.Resources.begin(), Desc.Resources.end(),
-                     [&](const std::pair<uint64_t, const ResourceUsage> &E) {
-                       unsigned NumUnits =
-                           E.second.isReserved() ? 0U : E.second.NumUnits;
-                       unsigned Index = getResourceStateIndex(E.first);
-                       return Resources[Index]->isReady(NumUnits);
-                     });
+  return all_of(Desc.getResources(),
+                [&](const std::pair<uint64_t, const ResourceUsage> &E) {
+                  unsigned NumUnits =
+                      E.second.isReserved() ? 0U : E.second.NumUnits;
+                  unsigned Index = getResourceStateIndex(E.first);
+                  return Resources[Index]->isReady(NumUnits);
+                });
 }
 
 // Returns true if all resources are in-order, and there is at least one
@@ -232,7 +244,8 @@ bool ResourceManager::canBeIssued(const InstrDesc &Desc) const {
 bool ResourceManager::mustIssueImmediately(const InstrDesc &Desc) const {
   if (!canBeIssued(Desc))
     return false;
-  bool AllInOrderResources = all_of(Desc.Buffers, [&](uint64_t BufferMask) {
+  ArrayRef<uint64_t> Buffers = Desc.getBuffers();
+  bool AllInOrderResources = all_of(Buffers, [&](uint64_t BufferMask) {
     unsigned Index = getResourceStateIndex(BufferMask);
     const ResourceState &Resource = *Resources[Index];
     return Resource.isInOrder() || Resource.isADispatchHazard();
@@ -240,15 +253,15 @@ bool ResourceManager::mustIssueImmediately(const InstrDesc &Desc) const {
   if (!AllInOrderResources)
     return false;
 
-  return any_of(Desc.Buffers, [&](uint64_t BufferMask) {
+  return any_of(Buffers, [&](uint64_t BufferMask) {
     return Resources[getResourceStateIndex(BufferMask)]->isADispatchHazard();
   });
 }
 
 void ResourceManager::issueInstruction(
     const InstrDesc &Desc,
-    SmallVectorImpl<std::pair<ResourceRef, double>> &Pipes) {
-  for (const std::pair<uint64_t, ResourceUsage> &R : Desc.Resources) {
+    SmallVectorImpl<std::pair<ResourceRef, double>> *Pipes) {
+  for (const std::pair<uint64_t, ResourceUsage> &R : Desc.getResources()) {
     const CycleSegment &CS = R.second.CS;
     if (!CS.size()) {
       releaseResource(R.first);
@@ -259,40 +272,104 @@ void ResourceManager::issueInstruction(
     if (!R.second.isReserved()) {
       ResourceRef Pipe = selectPipe(R.first);
       use(Pipe);
-      BusyResources[Pipe] += CS.size();
+      setBusy(Pipe, CS.size());
+      if (!Pipes)
+        continue;
       // Replace the resource mask with a valid processor resource index.
       const ResourceState &RS = *Resources[getResourceStateIndex(Pipe.first)];
       Pipe.first = RS.getProcResourceID();
-      Pipes.emplace_back(
+      Pipes->emplace_back(
           std::pair<ResourceRef, double>(Pipe, static_cast<double>(CS.size())));
     } else {
       assert((countPopulation(R.first) > 1) && "Expected a group!");
       // Mark this group as reserved.
       assert(R.second.isReserved());
       reserveResource(R.first);
-      BusyResources[ResourceRef(R.first, R.first)] += CS.size();
+      setBusy(ResourceRef(R.first, R.first), CS.size());
     }
   }
 }
 
+void ResourceManager::setBusy(const ResourceRef &RR, unsigned NumCycles) {
+  // A resource that is already busy is released NumCycles later.
+  auto Result = BusyResources.insert(std::make_pair(RR, CurrentCycle));
+  unsigned &ReleaseCycle = Result.first->second;
+  ReleaseCycle += NumCycles;
+  TimingWheel[ReleaseCycle % TimingWheelSize].emplace_back(RR);
+}
+
 void ResourceManager::cycleEvent(SmallVectorImpl<ResourceRef> &ResourcesFreed) {
-  for (std::pair<ResourceRef, unsigned> &BR : BusyResources) {
-    if (BR.second)
-      BR.second--;
-    if (!BR.second) {
-      // Release this resource.
-      const ResourceRef &RR = BR.first;
-
-      if (countPopulation(RR.first) == 1)
-        release(RR);
-
-      releaseResource(RR.first);
-      ResourcesFreed.push_back(RR);
+  ++CurrentCycle;
+
+  SmallVectorImpl<ResourceRef> &Slot =
+      TimingWheel[CurrentCycle % TimingWheelSize];
+  unsigned NumEntries = 0;
+  for (const ResourceRef &RR : Slot) {
+    auto It = BusyResources.find(RR);
+    if (It == BusyResources.end())
+      continue;
+
+    // Keep resources that are released in a later rotation of the wheel. An
+    // entry is stale if the release of RR has been postponed to another slot.
+    if (It->second != CurrentCycle) {
+      if (It->second % TimingWheelSize == CurrentCycle % TimingWheelSize)
+        Slot[NumEntries++] = RR;
+      continue;
     }
+
+    // Release this resource.
+    if (countPopulation(RR.first) == 1)
+      release(RR);
+
+    releaseResource(RR.first);
+    ResourcesFreed.push_back(RR);
+    BusyResources.erase(It);
+  }
+
+  Slot.resize(NumEntries);
+}
+
+unsigned ResourceManager::getNextReleaseCycle() const {
+  unsigned ReleaseCycle = UNBOUNDED_IDLE_CYCLES;
+  for (const std::pair<ResourceRef, unsigned> &BR : BusyResources)
+    ReleaseCycle = std::min(ReleaseCycle, BR.second);
+  return ReleaseCycle;
+}
+
+unsigned ResourceManager::getNumIdleCycles() const {
+  unsigned ReleaseCycle = getNextReleaseCycle();
+  if (ReleaseCycle == UNBOUNDED_IDLE_CYCLES)
+    return UNBOUNDED_IDLE_CYCLES;
+  assert(ReleaseCycle > CurrentCycle && "Resource was not released!");
+  return ReleaseCycle - CurrentCycle - 1;
+}
+
+void ResourceManager::skipCycles(unsigned NumCycles) {
+  assert(NumCycles <= getNumIdleCycles() && "Skipping a resource release!");
+  CurrentCycle += NumCycles;
+}
+
+void ResourceManager::encodeState(StateSignature &S) const {
+  for (unsigned I = 0, E = Resources.size(); I < E; ++I) {
+    if (Resources[I])
+      Resources[I]->encodeState(S);
+    if (Strategies[I])
+      Strategies[I]->encodeState(S);
   }
 
-  for (const ResourceRef &RF : ResourcesFreed)
-    BusyResources.erase(RF);
+  // The timing wheel is not encoded. Its content only depends on the release
+  // cycles of busy resources.
+  using BusyResourceEntry = std::pair<ResourceRef, unsigned>;
+  SmallVector<BusyResourceEntry, 8> Busy;
+  for (const BusyResourceEntry &BR : BusyResources)
+    Busy.emplace_back(BR.first, BR.second - CurrentCycle);
+  llvm::sort(Busy.begin(), Busy.end());
+  S.add(Busy.size());
+  for (const BusyResourceEntry &BR : Busy) {
+    S.add(BR.first.first);
+    S.add(BR.first.second);
+    S.add(BR.second);
+  }
 }
 
 void ResourceManager::reserveResource(uint64_t ResourceID) {
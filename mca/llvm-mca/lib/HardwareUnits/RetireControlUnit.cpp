@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "HardwareUnits/RetireControlUnit.h"
+#include "StateSignature.h"
 #include "llvm/Support/Debug.h"
 
 using namespace llvm;
@@ -77,6 +78,19 @@ void RetireControlUnit::onInstructionExecuted(unsigned TokenID) {
   Queue[TokenID].Executed = true;
 }
 
+void RetireControlUnit::encodeState(StateSignature &S) const {
+  S.add(AvailableSlots);
+  unsigned Index = CurrentInstructionSlotIdx;
+  for (unsigned I = AvailableSlots, E = Queue.size(); I < E;) {
+    const RUToken &Token = Queue[Index];
+    S.addIndex(Token.IR.getSourceIndex());
+    S.add(Token.NumSlots);
+    S.add(Token.Executed);
+    I += Token.NumSlots;
+    Index = (Index + Token.NumSlots) % Queue.size();
+  }
+}
+
 #ifndef NDEBUG
 void RetireControlUnit::dump() const {
   dbgs() << "Retire Unit: { Total Slots=" << Queue.size()
@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "HardwareUnits/Scheduler.h"
+#include "StateSignature.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -33,7 +34,8 @@ DefaultSchedulerStrategy::~DefaultSchedulerStrategy() = default;
 #ifndef NDEBUG
 void Scheduler::dump() const {
   dbgs() << "[SCHEDULER]: WaitSet size is: " << WaitSet.size() << '\n';
-  dbgs() << "[SCHEDULER]: ReadySet size is: " << ReadySet.size() << '\n';
+  dbgs() << "[SCHEDULER]: PendingSet size is: " << PendingSet.size() << '\n';
+  dbgs() << "[SCHEDULER]: ReadySet size is: " << ReadyRanks.size() << '\n';
   dbgs() << "[SCHEDULER]: IssuedSet size is: " << IssuedSet.size() << '\n';
   Resources->dump();
 }
@@ -42,7 +44,7 @@ void Scheduler::dump() const {
 Scheduler::Status Scheduler::isAvailable(const InstRef &IR) const {
   const InstrDesc &Desc = IR.getInstruction()->getDesc();
 
-  switch (Resources->canBeDispatched(Desc.Buffers)) {
+  switch (Resources->canBeDispatched(Desc.getBuffers())) {
   case ResourceStateEvent::RS_BUFFER_UNAVAILABLE:
     return Scheduler::SC_BUFFERS_FULL;
   case ResourceStateEvent::RS_RESERVED:
@@ -66,12 +68,13 @@ Scheduler::Status Scheduler::isAvailable(const InstRef &IR) const {
 
 void Scheduler::issueInstructionImpl(
     InstRef &IR,
-    SmallVectorImpl<std::pair<ResourceRef, double>> &UsedResources) {
+    SmallVectorImpl<std::pair<ResourceRef, double>> *UsedResources) {
   Instruction *IS = IR.getInstruction();
   const InstrDesc &D = IS->getDesc();
 
   // Issue the instruction and collect all the consumed resources
-  // into a vector. That vector is then used to notify the listener.
+  // into a vector (if requested). That vector is then used to notify the
+  // listeners.
   Resources->issueInstruction(D, UsedResources);
 
   // Notify the instruction that it started executing.
@@ -86,76 +89,235 @@ void Scheduler::issueInstructionImpl(
 
 // Release the buffered resources and issue the instruction.
 void Scheduler::issueInstruction(
-    InstRef &IR, SmallVectorImpl<std::pair<ResourceRef, double>> &UsedResources,
+    InstRef &IR, SmallVectorImpl<std::pair<ResourceRef, double>> *UsedResources,
     SmallVectorImpl<InstRef> &ReadyInstructions) {
   const Instruction &Inst = *IR.getInstruction();
   bool HasDependentUsers = Inst.hasDependentUsers();
 
-  Resources->releaseBuffers(Inst.getDesc().Buffers);
+  SmallVector<unsigned, 4> DependentInsts;
+  if (HasDependentUsers)
+    collectDependentInstructions(IR, DependentInsts);
+
+  Resources->releaseBuffers(Inst.getDesc().getBuffers());
   issueInstructionImpl(IR, UsedResources);
   // Instructions that have been issued during this cycle might have unblocked
   // other dependent instructions. Dependent instructions may be issued during
   // this same cycle if operands have ReadAdvance entries.  Promote those
   // instructions to the ReadySet and notify the caller that those are ready.
-  if (HasDependentUsers)
+  if (HasDependentUsers) {
+    for (unsigned Index : DependentInsts) {
+      WaitEntry &Entry = WaitSet.find(Index)->second;
+      Instruction &IS = *Entry.IR.getInstruction();
+      IS.update();
+      scheduleWakeup(Entry);
+    }
     promoteToReadySet(ReadyInstructions);
+  }
+}
+
+void Scheduler::addToWaitSet(const InstRef &IR) {
+  const unsigned Index = IR.getSourceIndex();
+  WaitEntry &Entry = WaitSet[Index];
+  Entry.IR = IR;
+  Entry.LastUpdateCycle = CurrentCycle;
+
+  // Register this instruction to the writes that have not been issued yet.
+  const Instruction &IS = *IR.getInstruction();
+  for (const ReadState &Use : IS.getUses())
+    if (Use.getCyclesLeft() == UNKNOWN_CYCLES && !Use.isReady())
+      ReadUsers[&Use] = Index;
+
+  for (const WriteState &Def : IS.getDefs()) {
+    const WriteState *Write = Def.getDependentWrite();
+    if (Write && Write->getCyclesLeft() == UNKNOWN_CYCLES)
+      WriteUsers[Write].push_back(Index);
+  }
+
+  scheduleWakeup(Entry);
+}
+
+void Scheduler::scheduleWakeup(const WaitEntry &Entry) {
+  assert(Entry.LastUpdateCycle == CurrentCycle && "Stale instruction state!");
+  const Instruction &IS = *Entry.IR.getInstruction();
+  if (IS.isReady()) {
+    PendingSet.emplace_back(Entry.IR);
+    return;
+  }
+
+  // Instructions that depend on writes which have not been issued yet are
+  // woken up by method collectDependentInstructions().
+  unsigned NumCycles = IS.getNumIdleCycles();
+  if (NumCycles != UNBOUNDED_IDLE_CYCLES)
+    WakeupQueue.emplace(CurrentCycle + NumCycles + 1,
+                        Entry.IR.getSourceIndex());
+}
+
+void Scheduler::collectDependentInstructions(const InstRef &IR,
+                                             SmallVectorImpl<unsigned> &Users) {
+  for (const WriteState &Def :
+       IR.getInstruction()->getDefs()) {
+    for (const std::pair<ReadState *, int> &User : Def.getUsers()) {
+      auto It = ReadUsers.find(User.first);
+      if (It != ReadUsers.end())
+        Users.emplace_back(It->second);
+    }
+
+    // A write can only be issued once.
+    auto It = WriteUsers.find(&Def);
+    if (It != WriteUsers.end()) {
+      Users.append(It->second.begin(), It->second.end());
+      WriteUsers.erase(It);
+    }
+  }
+
+  llvm::sort(Users.begin(), Users.end());
+  Users.erase(std::unique(Users.begin(), Users.end()), Users.end());
+
+  if (ScanCounters)
+    ScanCounters->WaitSetUpdates += Users.size();
+
+  // Account for the cycles elapsed since the last update.
+  for (unsigned Index : Users) {
+    WaitEntry &Entry = WaitSet.find(Index)->second;
+    Entry.IR.getInstruction()->skipCycles(CurrentCycle -
+                                          Entry.LastUpdateCycle);
+    Entry.LastUpdateCycle = CurrentCycle;
+  }
+}
+
+void Scheduler::wakeupInstructions() {
+  while (!WakeupQueue.empty() && WakeupQueue.top().first <= CurrentCycle) {
+    const unsigned Index = WakeupQueue.top().second;
+    WakeupQueue.pop();
+
+    if (ScanCounters)
+      ++ScanCounters->WaitSetUpdates;
+
+    WaitEntry &Entry = WaitSet.find(Index)->second;
+    Instruction &IS = *Entry.IR.getInstruction();
+    IS.skipCycles(CurrentCycle - Entry.LastUpdateCycle - 1);
+    IS.cycleEvent();
+    Entry.LastUpdateCycle = CurrentCycle;
+    scheduleWakeup(Entry);
+  }
 }
 
 void Scheduler::promoteToReadySet(SmallVectorImpl<InstRef> &Ready) {
-  // Scan the set of waiting instructions and promote them to the
-  // ready queue if operands are all ready.
+  // Scan the set of pending instructions and promote them to the
+  // ready queue if memory dependencies are met.
+  if (ScanCounters)
+    ScanCounters->PendingSetScans += PendingSet.size();
   unsigned RemovedElements = 0;
-  for (auto I = WaitSet.begin(), E = WaitSet.end(); I != E;) {
+  for (auto I = PendingSet.begin(), E = PendingSet.end(); I != E;) {
     InstRef &IR = *I;
     if (!IR.isValid())
       break;
 
-    // Check if this instruction is now ready. In case, force
-    // a transition in state using method 'update()'.
-    Instruction &IS = *IR.getInstruction();
-    if (!IS.isReady())
-      IS.update();
-
     // Check if there are still unsolved data dependencies.
     if (!isReady(IR)) {
       ++I;
       continue;
     }
 
+    const Instruction &IS = *IR.getInstruction();
+    for (const ReadState &Use : IS.getUses())
+      ReadUsers.erase(&Use);
+    WaitSet.erase(IR.getSourceIndex());
+
     Ready.emplace_back(IR);
-    ReadySet.emplace_back(IR);
+    addToReadySet(IR);
 
     IR.invalidate();
     ++RemovedElements;
     std::iter_swap(I, E - RemovedElements);
   }
 
-  WaitSet.resize(WaitSet.size() - RemovedElements);
+  PendingSet.resize(PendingSet.size() - RemovedElements);
 }
 
-InstRef Scheduler::select() {
-  unsigned QueueIndex = ReadySet.size();
-  for (unsigned I = 0, E = ReadySet.size(); I != E; ++I) {
-    const InstRef &IR = ReadySet[I];
-    if (QueueIndex == ReadySet.size() ||
-        Strategy->compare(IR, ReadySet[QueueIndex])) {
-      const InstrDesc &D = IR.getInstruction()->getDesc();
-      if (Resources->canBeIssued(D))
-        QueueIndex = I;
+void Scheduler::addToReadySet(const InstRef &IR) {
+  const Instruction &IS = *IR.getInstruction();
+  auto Result = ReadyQueueIndices.insert(
+      std::make_pair(&IS.getDesc(), static_cast<unsigned>(ReadySet.size())));
+  if (Result.second)
+    ReadySet.emplace_back();
+
+  int Rank = Strategy->computeRank(IR);
+  ReadySet[Result.first->second].insert(ReadyEntry{Rank, IR});
+  ReadyRanks[IR.getSourceIndex()] = Rank;
+  for (const WriteState &Def : IS.getDefs())
+    ReadyWrites[&Def] = IR;
+}
+
+void Scheduler::updateRank(const InstRef &IR) {
+  auto It = ReadyRanks.find(IR.getSourceIndex());
+  assert(It != ReadyRanks.end() && "Instruction is not in the ReadySet!");
+  int Rank = Strategy->computeRank(IR);
+  if (Rank == It->second)
+    return;
+
+  const InstrDesc &Desc = IR.getInstruction()->getDesc();
+  ReadyQueue &Queue = ReadySet[ReadyQueueIndices.find(&Desc)->second];
+  Queue.erase(ReadyEntry{It->second, IR});
+  Queue.insert(ReadyEntry{Rank, IR});
+  It->second = Rank;
+}
+
+void Scheduler::updateProducerRanks(const InstRef &IR) {
+  if (ReadyWrites.empty())
+    return;
+
+  const Instruction &IS = *IR.getInstruction();
+  for (const ReadState &Use : IS.getUses()) {
+    for (const WriteState *Write : Use.getPendingWrites()) {
+      auto It = ReadyWrites.find(Write);
+      if (It != ReadyWrites.end())
+        updateRank(It->second);
     }
   }
 
-  if (QueueIndex == ReadySet.size())
+  for (const WriteState &Def : IS.getDefs()) {
+    if (const WriteState *Write = Def.getDependentWrite()) {
+      auto It = ReadyWrites.find(Write);
+      if (It != ReadyWrites.end())
+        updateRank(It->second);
+    }
+  }
+}
+
+InstRef Scheduler::select() {
+  // The best candidate of each queue is the first element. Resource
+  // availability only needs to be checked for candidates that would take
+  // priority over the current selection.
+  if (ScanCounters)
+    ScanCounters->ReadyQueueScans += ReadySet.size();
+  ReadyQueue *Selected = nullptr;
+  for (ReadyQueue &Queue : ReadySet) {
+    if (Queue.empty())
+      continue;
+    const ReadyEntry &Candidate = *Queue.begin();
+    if (Selected && !(Candidate < *Selected->begin()))
+      continue;
+    const InstrDesc &D = Candidate.IR.getInstruction()->getDesc();
+    if (Resources->canBeIssued(D))
+      Selected = &Queue;
+  }
+
+  if (!Selected)
     return InstRef();
 
   // We found an instruction to issue.
-  InstRef IR = ReadySet[QueueIndex];
-  std::swap(ReadySet[QueueIndex], ReadySet[ReadySet.size() - 1]);
-  ReadySet.pop_back();
+  InstRef IR = Selected->begin()->IR;
+  Selected->erase(Selected->begin());
+  ReadyRanks.erase(IR.getSourceIndex());
+  for (const WriteState &Def : IR.getInstruction()->getDefs())
+    ReadyWrites.erase(&Def);
   return IR;
 }
 
 void Scheduler::updateIssuedSet(SmallVectorImpl<InstRef> &Executed) {
+  if (ScanCounters)
+    ScanCounters->IssuedSetScans += IssuedSet.size();
   unsigned RemovedElements = 0;
   for (auto I = IssuedSet.begin(), E = IssuedSet.end(); I != E;) {
     InstRef &IR = *I;
@@ -183,6 +345,8 @@ void Scheduler::updateIssuedSet(SmallVectorImpl<InstRef> &Executed) {
 void Scheduler::cycleEvent(SmallVectorImpl<ResourceRef> &Freed,
                            SmallVectorImpl<InstRef> &Executed,
                            SmallVectorImpl<InstRef> &Ready) {
+  ++CurrentCycle;
+
   // Release consumed resources.
   Resources->cycleEvent(Freed);
 
@@ -191,11 +355,91 @@ void Scheduler::cycleEvent(SmallVectorImpl<ResourceRef> &Freed,
     IR.getInstruction()->cycleEvent();
 
   updateIssuedSet(Executed);
+  wakeupInstructions();
+  promoteToReadySet(Ready);
+}
 
-  for (InstRef &IR : WaitSet)
-    IR.getInstruction()->cycleEvent();
+unsigned Scheduler::getNumIdleCycles() const {
+  // Instructions in the ReadySet are only waiting on processor resources.
+  if (llvm::any_of(ReadySet, [&](const ReadyQueue &Queue) {
+        return !Queue.empty() &&
+               Resources->canBeIssued(
+                   Queue.begin()->IR.getInstruction()->getDesc());
+      }))
+    return 0;
 
-  promoteToReadySet(Ready);
+  unsigned NumCycles = Resources->getNumIdleCycles();
+  for (const InstRef &IR : IssuedSet)
+    NumCycles = std::min(NumCycles, IR.getInstruction()->getNumIdleCycles());
+
+  // Instructions in the PendingSet can only be promoted to the ReadySet in
+  // response to other load/store events.
+  if (llvm::any_of(PendingSet, [&](const InstRef &IR) { return isReady(IR); }))
+    return 0;
+
+  if (!WakeupQueue.empty())
+    NumCycles = std::min(NumCycles, WakeupQueue.top().first - CurrentCycle - 1);
+
+  return NumCycles;
+}
+
+void Scheduler::skipCycles(unsigned NumCycles) {
+  Resources->skipCycles(NumCycles);
+
+  for (InstRef &IR : IssuedSet)
+    IR.getInstruction()->skipCycles(NumCycles);
+
+  // Waiting instructions are updated lazily.
+  CurrentCycle += NumCycles;
+}
+
+void Scheduler::encodeState(StateSignature &S) const {
+  using IndexPair = std::pair<unsigned, unsigned>;
+  SmallVector<IndexPair, 16> Waiting;
+  for (const std::pair<unsigned, WaitEntry> &Entry : WaitSet)
+    Waiting.emplace_back(Entry.first,
+                         CurrentCycle - Entry.second.LastUpdateCycle);
+  llvm::sort(Waiting.begin(), Waiting.end());
+  S.add(Waiting.size());
+  for (const IndexPair &Entry : Waiting) {
+    S.addIndex(Entry.first);
+    S.add(Entry.second);
+  }
+
+  std::priority_queue<WakeupEntry, std::vector<WakeupEntry>,
+                      std::greater<WakeupEntry>>
+      Wakeups(WakeupQueue);
+  S.add(Wakeups.size());
+  for (; !Wakeups.empty(); Wakeups.pop()) {
+    S.add(Wakeups.top().first - CurrentCycle);
+    S.addIndex(Wakeups.top().second);
+  }
+
+  SmallVector<unsigned, 16> Indices;
+  for (const InstRef &IR : PendingSet)
+    Indices.push_back(IR.getSourceIndex());
+  llvm::sort(Indices.begin(), Indices.end());
+  S.add(Indices.size());
+  for (unsigned Index : Indices)
+    S.addIndex(Index);
+
+  // Ranks are derived from source indices, so they are encoded relative to
+  // the base index.
+  SmallVector<std::pair<unsigned, int>, 16> Ready(ReadyRanks.begin(),
+                                                  ReadyRanks.end());
+  llvm::sort(Ready.begin(), Ready.end());
+  S.add(Ready.size());
+  for (const std::pair<unsigned, int> &Entry : Ready) {
+    S.addIndex(Entry.first);
+    S.add(static_cast<int64_t>(Entry.second) - S.getBaseIndex());
+  }
+
+  S.add(IssuedSet.size());
+  for (const InstRef &IR : IssuedSet)
+    S.addIndex(IR.getSourceIndex());
+
+  Resources->encodeState(S);
+  LSU->encodeState(S);
 }
 
 bool Scheduler::mustIssueImmediately(const InstRef &IR) const {
@@ -207,8 +451,12 @@ bool Scheduler::mustIssueImmediately(const InstRef &IR) const {
 }
 
 void Scheduler::dispatch(const InstRef &IR) {
+  // Register writes consumed by IR now have one more user. This may change the
+  // rank of instructions in the ReadySet.
+  updateProducerRanks(IR);
+
   const InstrDesc &Desc = IR.getInstruction()->getDesc();
-  Resources->reserveBuffers(Desc.Buffers);
+  Resources->reserveBuffers(Desc.getBuffers());
 
   // If necessary, reserve queue entries in the load-store unit (LSU).
   bool IsMemOp = Desc.MayLoad || Desc.MayStore;
@@ -217,7 +465,7 @@ void Scheduler::dispatch(const InstRef &IR) {
 
   if (!isReady(IR)) {
     LLVM_DEBUG(dbgs() << "[SCHEDULER] Adding #" << IR << " to the WaitSet\n");
-    WaitSet.push_back(IR);
+    addToWaitSet(IR);
     return;
   }
 
@@ -231,7 +479,7 @@ void Scheduler::dispatch(const InstRef &IR) {
   // renaming stage.
   if (!mustIssueImmediately(IR)) {
     LLVM_DEBUG(dbgs() << "[SCHEDULER] Adding #" << IR << " to the ReadySet\n");
-    ReadySet.push_back(IR);
+    addToReadySet(IR);
   }
 }
 
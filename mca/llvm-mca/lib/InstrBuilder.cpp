@@ -13,10 +13,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "InstrBuilder.h"
+#include "InstrDescCache.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/MC/MCInst.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -26,14 +29,13 @@ namespace mca {
 
 using namespace llvm;
 
-static void initializeUsedResources(InstrDesc &ID,
+static void initializeUsedResources(InstrDescData &ID,
                                     const MCSchedClassDesc &SCDesc,
                                     const MCSubtargetInfo &STI,
                                     ArrayRef<uint64_t> ProcResourceMasks) {
   const MCSchedModel &SM = STI.getSchedModel();
 
   // Populate resources consumed.
-  using ResourcePlusCycles = std::pair<uint64_t, ResourceUsage>;
   std::vector<ResourcePlusCycles> Worklist;
 
   // Track cycles contributed by resources that are in a "Super" relationship.
@@ -140,7 +142,24 @@ static void initializeUsedResources(InstrDesc &ID,
   });
 }
 
-static void computeMaxLatency(InstrDesc &ID, const MCInstrDesc &MCDesc,
+// Warns about control flow instructions, which are not correctly modeled.
+static void warnAboutControlFlow(const MCInstrDesc &MCDesc,
+                                 raw_ostream &OS) {
+  if (MCDesc.isCall()) {
+    // We don't correctly model calls.
+    WithColor::warning(OS) << "found a call in the input assembly sequence.\n";
+    WithColor::note(OS) << "call instructions are not correctly modeled. "
+                        << "Assume a latency of 100cy.\n";
+  }
+
+  if (MCDesc.isReturn()) {
+    WithColor::warning(OS) << "found a return instruction in the input"
+                           << " assembly sequence.\n";
+    WithColor::note(OS) << "program counter updates are ignored.\n";
+  }
+}
+
+static void computeMaxLatency(InstrDescData &ID, const MCInstrDesc &MCDesc,
                               const MCSchedClassDesc &SCDesc,
                               const MCSubtargetInfo &STI) {
   if (MCDesc.isCall()) {
@@ -155,7 +174,7 @@ static void computeMaxLatency(InstrDesc &ID, const MCInstrDesc &MCDesc,
   ID.MaxLatency = Latency < 0 ? 100U : static_cast<unsigned>(Latency);
 }
 
-Error InstrBuilder::populateWrites(InstrDesc &ID, const MCInst &MCI,
+Error InstrBuilder::populateWrites(InstrDescData &ID, const MCInst &MCI,
                                    unsigned SchedClassID) {
   const MCInstrDesc &MCDesc = MCII.get(MCI.getOpcode());
   const MCSchedModel &SM = STI.getSchedModel();
@@ -271,7 +290,7 @@ Error InstrBuilder::populateWrites(InstrDesc &ID, const MCInst &MCI,
   return ErrorSuccess();
 }
 
-Error InstrBuilder::populateReads(InstrDesc &ID, const MCInst &MCI,
+Error InstrBuilder::populateReads(InstrDescData &ID, const MCInst &MCI,
                                   unsigned SchedClassID) {
   const MCInstrDesc &MCDesc = MCII.get(MCI.getOpcode());
   unsigned NumExplicitDefs = MCDesc.getNumDefs();
@@ -322,6 +341,49 @@ Error InstrBuilder::populateReads(InstrDesc &ID, const MCInst &MCI,
   return ErrorSuccess();
 }
 
+static void appendToKey(SmallVectorImpl<char> &Key, uint64_t Value) {
+  const char *Bytes = reinterpret_cast<const char *>(&Value);
+  Key.append(Bytes, Bytes + sizeof(Value));
+}
+
+// Computes the key of MCI in the table of variant descriptors. The key is the
+// opcode followed by the kind and value of every operand. This includes every
+// operand that a variant scheduling predicate can inspect.
+static void getOperandsKey(const MCInst &MCI, SmallVectorImpl<char> &Key) {
+  appendToKey(Key, MCI.getOpcode());
+  for (const MCOperand &Op : MCI) {
+    if (Op.isReg()) {
+      Key.push_back('r');
+      appendToKey(Key, Op.getReg());
+    } else if (Op.isImm()) {
+      Key.push_back('i');
+      appendToKey(Key, Op.getImm());
+    } else if (Op.isFPImm()) {
+      Key.push_back('f');
+      appendToKey(Key, DoubleToBits(Op.getFPImm()));
+    } else if (Op.isExpr()) {
+      Key.push_back('e');
+      appendToKey(Key, reinterpret_cast<uintptr_t>(Op.getExpr()));
+    } else if (Op.isInst()) {
+      Key.push_back('n');
+      appendToKey(Key, reinterpret_cast<uintptr_t>(Op.getInst()));
+    } else {
+      Key.push_back('-');
+    }
+  }
+}
+
+// Computes the key of MCI in the table of resolved variant descriptors. Other
+// than the opcode, a descriptor only depends on the resolved scheduling class,
+// and on which operands of MCI are registers.
+static void getLayoutKey(const MCInst &MCI, unsigned SchedClassID,
+                         SmallVectorImpl<char> &Key) {
+  appendToKey(Key, MCI.getOpcode());
+  appendToKey(Key, SchedClassID);
+  for (const MCOperand &Op : MCI)
+    Key.push_back(Op.isReg() ? 'r' : '-');
+}
+
 Expected<const InstrDesc &>
 InstrBuilder::createInstrDescImpl(const MCInst &MCI) {
   assert(STI.getSchedModel().hasInstrSchedModel() &&
@@ -335,6 +397,7 @@ InstrBuilder::createInstrDescImpl(const MCInst &MCI) {
   // Then obtain the scheduling class information from the instruction.
   unsigned SchedClassID = MCDesc.getSchedClass();
   unsigned CPUID = SM.getProcessorID();
+  bool IsVariant = SM.getSchedClassDesc(SchedClassID)->isVariant();
 
   // Try to solve variant scheduling classes.
   if (SchedClassID) {
@@ -347,70 +410,97 @@ InstrBuilder::createInstrDescImpl(const MCInst &MCI) {
     }
   }
 
+  // Reuse the descriptor of an instruction with the same layout that
+  // resolved to the same scheduling class.
+  SmallString<32> LayoutKey;
+  if (IsVariant) {
+    getLayoutKey(MCI, SchedClassID, LayoutKey);
+    auto It = ResolvedVariants.find(LayoutKey);
+    if (It != ResolvedVariants.end())
+      return *It->second;
+  }
+
   // Check if this instruction is supported. Otherwise, report an error.
   const MCSchedClassDesc &SCDesc = *SM.getSchedClassDesc(SchedClassID);
   if (SCDesc.NumMicroOps == MCSchedClassDesc::InvalidNumMicroOps) {
     std::string ToString;
     llvm::raw_string_ostream OS(ToString);
-    WithColor::error() << "found an unsupported instruction in the input"
-                       << " assembly sequence.\n";
+    WithColor::error(*DiagOS) << "found an unsupported instruction in the input"
+                              << " assembly sequence.\n";
     MCIP.printInst(&MCI, OS, "", STI);
     OS.flush();
-    WithColor::note() << "instruction: " << ToString << '\n';
+    WithColor::note(*DiagOS) << "instruction: " << ToString << '\n';
     return make_error<StringError>(
         "Don't know how to analyze unsupported instructions",
         inconvertibleErrorCode());
   }
 
-  // Create a new empty descriptor.
-  std::unique_ptr<InstrDesc> ID = llvm::make_unique<InstrDesc>();
-  ID->NumMicroOps = SCDesc.NumMicroOps;
-
-  if (MCDesc.isCall()) {
-    // We don't correctly model calls.
-    WithColor::warning() << "found a call in the input assembly sequence.\n";
-    WithColor::note() << "call instructions are not correctly modeled. "
-                      << "Assume a latency of 100cy.\n";
-  }
+  // Populate the content of the new descriptor.
+  InstrDescData &ID = DescData;
+  ID.clear();
+  ID.NumMicroOps = SCDesc.NumMicroOps;
 
-  if (MCDesc.isReturn()) {
-    WithColor::warning() << "found a return instruction in the input"
-                         << " assembly sequence.\n";
-    WithColor::note() << "program counter updates are ignored.\n";
-  }
+  warnAboutControlFlow(MCDesc, *DiagOS);
 
-  ID->MayLoad = MCDesc.mayLoad();
-  ID->MayStore = MCDesc.mayStore();
-  ID->HasSideEffects = MCDesc.hasUnmodeledSideEffects();
+  ID.MayLoad = MCDesc.mayLoad();
+  ID.MayStore = MCDesc.mayStore();
+  ID.HasSideEffects = MCDesc.hasUnmodeledSideEffects();
 
-  initializeUsedResources(*ID, SCDesc, STI, ProcResourceMasks);
-  computeMaxLatency(*ID, MCDesc, SCDesc, STI);
-  if (auto Err = populateWrites(*ID, MCI, SchedClassID))
+  initializeUsedResources(ID, SCDesc, STI, ProcResourceMasks);
+  computeMaxLatency(ID, MCDesc, SCDesc, STI);
+  if (auto Err = populateWrites(ID, MCI, SchedClassID))
     return std::move(Err);
-  if (auto Err = populateReads(*ID, MCI, SchedClassID))
+  if (auto Err = populateReads(ID, MCI, SchedClassID))
     return std::move(Err);
 
-  LLVM_DEBUG(dbgs() << "\t\tMaxLatency=" << ID->MaxLatency << '\n');
-  LLVM_DEBUG(dbgs() << "\t\tNumMicroOps=" << ID->NumMicroOps << '\n');
+  LLVM_DEBUG(dbgs() << "\t\tMaxLatency=" << ID.MaxLatency << '\n');
+  LLVM_DEBUG(dbgs() << "\t\tNumMicroOps=" << ID.NumMicroOps << '\n');
 
   // Now add the new descriptor.
-  SchedClassID = MCDesc.getSchedClass();
-  if (!SM.getSchedClassDesc(SchedClassID)->isVariant()) {
-    Descriptors[MCI.getOpcode()] = std::move(ID);
-    return *Descriptors[MCI.getOpcode()];
+  const InstrDesc *Desc = InstrDesc::create(DescAllocator, ID);
+  if (!IsVariant) {
+    if (DescCache)
+      DescCache->insert(Opcode, MCI.getNumOperands(), *Desc);
+    Descriptors[MCI.getOpcode()] = Desc;
+    return *Desc;
   }
 
-  VariantDescriptors[&MCI] = std::move(ID);
-  return *VariantDescriptors[&MCI];
+  ResolvedVariants[LayoutKey] = Desc;
+  return *Desc;
 }
 
 Expected<const InstrDesc &>
 InstrBuilder::getOrCreateInstrDesc(const MCInst &MCI) {
-  if (Descriptors.find_as(MCI.getOpcode()) != Descriptors.end())
-    return *Descriptors[MCI.getOpcode()];
+  auto DescIt = Descriptors.find_as(MCI.getOpcode());
+  if (DescIt != Descriptors.end())
+    return *DescIt->second;
+
+  const MCInstrDesc &MCDesc = MCII.get(MCI.getOpcode());
+  const MCSchedModel &SM = STI.getSchedModel();
+  unsigned SchedClassID = MCDesc.getSchedClass();
+  if (SM.getSchedClassDesc(SchedClassID)->isVariant()) {
+    SmallString<64> Key;
+    getOperandsKey(MCI, Key);
+    auto It = VariantDescriptors.find(Key);
+    if (It != VariantDescriptors.end())
+      return *It->second;
+
+    Expected<const InstrDesc &> ID = createInstrDescImpl(MCI);
+    if (ID)
+      VariantDescriptors[Key] = &*ID;
+    return ID;
+  }
 
-  if (VariantDescriptors.find(&MCI) != VariantDescriptors.end())
-    return *VariantDescriptors[&MCI];
+  // Only descriptors of non-variant opcodes are in the persistent cache.
+  if (DescCache) {
+    DescData.clear();
+    if (DescCache->lookup(MCI.getOpcode(), MCI.getNumOperands(), DescData)) {
+      warnAboutControlFlow(MCDesc, *DiagOS);
+      const InstrDesc *Desc = InstrDesc::create(DescAllocator, DescData);
+      Descriptors[MCI.getOpcode()] = Desc;
+      return *Desc;
+    }
+  }
 
   return createInstrDescImpl(MCI);
 }
@@ -421,10 +511,41 @@ InstrBuilder::createInstruction(const MCInst &MCI) {
   if (!DescOrErr)
     return DescOrErr.takeError();
   const InstrDesc &D = *DescOrErr;
-  std::unique_ptr<Instruction> NewIS = llvm::make_unique<Instruction>(D);
+  std::unique_ptr<Instruction> NewIS;
+  if (InstructionPool.empty()) {
+    NewIS = llvm::make_unique<Instruction>(D);
+    ++Stats.NumAllocations;
+    Stats.PoolSize += sizeof(Instruction);
+  } else {
+    NewIS = std::move(InstructionPool.back());
+    InstructionPool.pop_back();
+    NewIS->reset(D);
+    ++Stats.NumReused;
+  }
+
+  ++Stats.NumCreated;
+  Stats.MaxInFlight = std::max(Stats.MaxInFlight, ++NumInFlight);
+
+  // Make sure that operands can be added without reallocating storage, so
+  // that pointers to register reads and writes stay valid.
+  ArrayRef<ReadDescriptor> Reads = D.getReads();
+  Instruction::VecUses &Uses = NewIS->getUses();
+  if (Reads.size() > Uses.capacity()) {
+    Stats.PoolSize += (Reads.size() - Uses.capacity()) * sizeof(ReadState);
+    ++Stats.NumAllocations;
+    Uses.reserve(Reads.size());
+  }
+
+  ArrayRef<WriteDescriptor> Writes = D.getWrites();
+  Instruction::VecDefs &Defs = NewIS->getDefs();
+  if (Writes.size() > Defs.capacity()) {
+    Stats.PoolSize += (Writes.size() - Defs.capacity()) * sizeof(WriteState);
+    ++Stats.NumAllocations;
+    Defs.reserve(Writes.size());
+  }
 
   // Initialize Reads first.
-  for (const ReadDescriptor &RD : D.Reads) {
+  for (const ReadDescriptor &RD : Reads) {
     int RegID = -1;
     if (!RD.isImplicitRead()) {
       // explicit read.
@@ -444,16 +565,16 @@ InstrBuilder::createInstruction(const MCInst &MCI) {
 
     // Okay, this is a register operand. Create a ReadState for it.
     assert(RegID > 0 && "Invalid register ID found!");
-    NewIS->getUses().emplace_back(llvm::make_unique<ReadState>(RD, RegID));
+    Uses.emplace_back(RD, RegID);
   }
 
   // Early exit if there are no writes.
-  if (D.Writes.empty())
+  if (Writes.empty())
     return std::move(NewIS);
 
   // Track register writes that implicitly clear the upper portion of the
   // underlying super-registers using an APInt.
-  APInt WriteMask(D.Writes.size(), 0);
+  APInt WriteMask(Writes.size(), 0);
 
   // Now query the MCInstrAnalysis object to obtain information about which
   // register writes implicitly clear the upper portion of a super-register.
@@ -465,7 +586,7 @@ InstrBuilder::createInstruction(const MCInst &MCI) {
 
   // Initialize writes.
   unsigned WriteIndex = 0;
-  for (const WriteDescriptor &WD : D.Writes) {
+  for (const WriteDescriptor &WD : Writes) {
     unsigned RegID = WD.isImplicitWrite() ? WD.RegisterID
                                           : MCI.getOperand(WD.OpIndex).getReg();
     // Check if this is a optional definition that references NoReg.
@@ -475,11 +596,20 @@ InstrBuilder::createInstruction(const MCInst &MCI) {
     }
 
     assert(RegID && "Expected a valid register ID!");
-    NewIS->getDefs().emplace_back(llvm::make_unique<WriteState>(
-        WD, RegID, /* ClearsSuperRegs */ WriteMask[WriteIndex]));
+    Defs.emplace_back(WD, RegID, /* ClearsSuperRegs */ WriteMask[WriteIndex]);
     ++WriteIndex;
   }
 
   return std::move(NewIS);
 }
+
+void InstrBuilder::recycleInstruction(std::unique_ptr<Instruction> IS) {
+  assert(NumInFlight && "Unexpected instruction!");
+  --NumInFlight;
+
+  // Younger partial writes may still reference writes of this instruction.
+  for (WriteState &WS : IS->getDefs())
+    WS.releaseWriteUsers();
+  InstructionPool.emplace_back(std::move(IS));
+}
 } // namespace mca
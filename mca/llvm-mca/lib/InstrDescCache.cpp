@@ -0,0 +1,449 @@
+//===--------------------- InstrDescCache.cpp -------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements the persistent cache of instruction descriptors.
+///
+//===----------------------------------------------------------------------===//
+
+#include "InstrDescCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "llvm-mca"
+
+STATISTIC(NumCacheHits, "Number of descriptors loaded from the cache");
+STATISTIC(NumCacheMisses, "Number of descriptors missing from the cache");
+
+namespace mca {
+
+using namespace llvm;
+
+static const char CacheMagic[8] = {'M', 'C', 'A', 'D', 'E', 'S', 'C', '\0'};
+// Bump this version every time the layout of a record, or the semantic of a
+// field of InstrDesc, changes.
+static const uint32_t CacheFormatVersion = 1;
+
+// Magic, format version, fingerprint, key size and number of entries.
+static const unsigned HeaderSize = 8 + 4 + 8 + 4 + 4;
+// Opcode and record offset.
+static const unsigned IndexEntrySize = 4 + 4;
+// Number of operands, max latency, number of micro opcodes, flags, and the
+// number of writes, reads, resources and buffers.
+static const unsigned RecordHeaderSize = 8 * 4;
+static const unsigned WriteSize = 5 * 4;
+static const unsigned ReadSize = 4 * 4;
+static const unsigned ResourceSize = 8 + 4 * 4;
+static const unsigned BufferSize = 8;
+
+enum RecordFlags : uint32_t {
+  RF_MayLoad = 1 << 0,
+  RF_MayStore = 1 << 1,
+  RF_HasSideEffects = 1 << 2
+};
+
+namespace {
+// Computes a fingerprint of a sequence of integers. The fingerprint must be
+// the same in every process, so llvm::hash_code (whose seed is an
+// implementation detail) is not used. This is a word-wise FNV-1a.
+class FingerprintBuilder {
+  uint64_t Hash;
+
+public:
+  FingerprintBuilder() : Hash(14695981039346656037ULL) {}
+
+  void add(uint64_t Value) {
+    Hash ^= Value;
+    Hash *= 1099511628211ULL;
+  }
+
+  void add(StringRef Str) {
+    add(Str.size());
+    for (unsigned char C : Str)
+      add(C);
+  }
+
+  uint64_t get() const { return Hash; }
+};
+
+// Reads fixed-size little-endian fields from a record.
+class RecordReader {
+  const char *Ptr;
+
+public:
+  RecordReader(const char *P) : Ptr(P) {}
+
+  uint32_t read32() {
+    uint32_t Value = support::endian::read32le(Ptr);
+    Ptr += 4;
+    return Value;
+  }
+
+  uint64_t read64() {
+    uint64_t Value = support::endian::read64le(Ptr);
+    Ptr += 8;
+    return Value;
+  }
+};
+} // end of anonymous namespace
+
+static void write32(std::string &Out, uint32_t Value) {
+  char Bytes[4];
+  support::endian::write32le(Bytes, Value);
+  Out.append(Bytes, 4);
+}
+
+static void write64(std::string &Out, uint64_t Value) {
+  char Bytes[8];
+  support::endian::write64le(Bytes, Value);
+  Out.append(Bytes, 8);
+}
+
+// Computes a fingerprint of every input used to build instruction
+// descriptors: the scheduling model of STI, and the opcode descriptors.
+static uint64_t computeFingerprint(const MCSubtargetInfo &STI,
+                                   const MCInstrInfo &MCII) {
+  const MCSchedModel &SM = STI.getSchedModel();
+  FingerprintBuilder FP;
+  FP.add(SM.IssueWidth);
+  FP.add(SM.MicroOpBufferSize);
+  FP.add(SM.LoadLatency);
+  FP.add(SM.HighLatency);
+  FP.add(SM.NumProcResourceKinds);
+  FP.add(SM.NumSchedClasses);
+
+  for (unsigned I = 0, E = SM.getNumProcResourceKinds(); I < E; ++I) {
+    const MCProcResourceDesc &PR = *SM.getProcResource(I);
+    FP.add(PR.NumUnits);
+    FP.add(PR.SuperIdx);
+    FP.add(PR.BufferSize);
+    FP.add(PR.SubUnitsIdxBegin != nullptr);
+    if (PR.SubUnitsIdxBegin)
+      for (unsigned U = 0; U < PR.NumUnits; ++U)
+        FP.add(PR.SubUnitsIdxBegin[U]);
+  }
+
+  for (unsigned I = 0, E = SM.NumSchedClasses; I < E; ++I) {
+    const MCSchedClassDesc &SCDesc = *SM.getSchedClassDesc(I);
+    FP.add(SCDesc.NumMicroOps);
+    FP.add(SCDesc.BeginGroup);
+    FP.add(SCDesc.EndGroup);
+    FP.add(SCDesc.NumWriteProcResEntries);
+    for (const MCWriteProcResEntry *PRE = STI.getWriteProcResBegin(&SCDesc),
+                                   *PREE = STI.getWriteProcResEnd(&SCDesc);
+         PRE != PREE; ++PRE) {
+      FP.add(PRE->ProcResourceIdx);
+      FP.add(PRE->Cycles);
+    }
+    FP.add(SCDesc.NumWriteLatencyEntries);
+    for (unsigned J = 0; J < SCDesc.NumWriteLatencyEntries; ++J) {
+      const MCWriteLatencyEntry &WLE = *STI.getWriteLatencyEntry(&SCDesc, J);
+      FP.add(WLE.Cycles);
+      FP.add(WLE.WriteResourceID);
+    }
+  }
+
+  for (unsigned Opcode = 0, E = MCII.getNumOpcodes(); Opcode < E; ++Opcode) {
+    const MCInstrDesc &MCDesc = MCII.get(Opcode);
+    FP.add(MCDesc.getSchedClass());
+    FP.add(MCDesc.getNumOperands());
+    FP.add(MCDesc.getNumDefs());
+    FP.add(MCDesc.getFlags());
+    FP.add(MCDesc.getNumImplicitDefs());
+    for (unsigned J = 0; J < MCDesc.getNumImplicitDefs(); ++J)
+      FP.add(MCDesc.getImplicitDefs()[J]);
+    FP.add(MCDesc.getNumImplicitUses());
+    for (unsigned J = 0; J < MCDesc.getNumImplicitUses(); ++J)
+      FP.add(MCDesc.getImplicitUses()[J]);
+  }
+
+  return FP.get();
+}
+
+InstrDescCache::InstrDescCache(StringRef P, StringRef K, uint64_t FP)
+    : Path(P), Key(K), Fingerprint(FP), Index(nullptr), NumEntries(0) {}
+
+std::unique_ptr<InstrDescCache>
+InstrDescCache::open(StringRef Dir, StringRef Triple,
+                     const MCSubtargetInfo &STI, const MCInstrInfo &MCII) {
+  std::string Key =
+      (Triple + ":" + STI.getCPU() + ":" + LLVM_VERSION_STRING).str();
+
+  // Different keys may map to the same file name. That is harmless, since
+  // the full key is validated when the file is loaded.
+  FingerprintBuilder KeyHash;
+  KeyHash.add(Key);
+  SmallString<256> Path(Dir);
+  sys::path::append(Path, "mca-" + utohexstr(KeyHash.get()) + ".desc");
+
+  std::unique_ptr<InstrDescCache> Cache(
+      new InstrDescCache(Path, Key, computeFingerprint(STI, MCII)));
+  if (!Cache->loadFile())
+    Cache->Buffer.reset();
+  return Cache;
+}
+
+bool InstrDescCache::loadFile() {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr = MemoryBuffer::getFile(
+      Path, /* FileSize */ -1, /* RequiresNullTerminator */ false);
+  if (!BufferOrErr)
+    return false;
+  Buffer = std::move(*BufferOrErr);
+
+  StringRef Data = Buffer->getBuffer();
+  if (Data.size() < HeaderSize || !Data.startswith(StringRef(CacheMagic, 8)))
+    return false;
+
+  RecordReader Header(Data.data() + 8);
+  if (Header.read32() != CacheFormatVersion ||
+      Header.read64() != Fingerprint)
+    return false;
+  uint32_t KeySize = Header.read32();
+  uint64_t Entries = Header.read32();
+  uint64_t IndexOffset = HeaderSize + (uint64_t)KeySize;
+  if (IndexOffset + Entries * IndexEntrySize > Data.size() ||
+      Data.substr(HeaderSize, KeySize) != Key)
+    return false;
+
+  // The index must be sorted for the binary search in getRecord(). Records
+  // are only validated when they are accessed, so that loading the cache
+  // doesn't touch every page of the file.
+  const char *IndexPtr = Data.data() + IndexOffset;
+  for (uint64_t I = 1; I < Entries; ++I) {
+    const char *Entry = IndexPtr + I * IndexEntrySize;
+    if (support::endian::read32le(Entry - IndexEntrySize) >=
+        support::endian::read32le(Entry))
+      return false;
+  }
+
+  Index = IndexPtr;
+  NumEntries = Entries;
+  return true;
+}
+
+// Returns the size of an encoded record, given the content of its header.
+static uint64_t getRecordSize(const char *Record) {
+  RecordReader R(Record + 4 * 4);
+  uint64_t Size = RecordHeaderSize;
+  Size += R.read32() * (uint64_t)WriteSize;
+  Size += R.read32() * (uint64_t)ReadSize;
+  Size += R.read32() * (uint64_t)ResourceSize;
+  Size += R.read32() * (uint64_t)BufferSize;
+  return Size;
+}
+
+StringRef InstrDescCache::getRecord(unsigned Opcode) const {
+  // Binary search the index.
+  unsigned Low = 0, High = NumEntries;
+  while (Low < High) {
+    unsigned Mid = Low + (High - Low) / 2;
+    const char *Entry = Index + Mid * IndexEntrySize;
+    uint32_t EntryOpcode = support::endian::read32le(Entry);
+    if (EntryOpcode == Opcode) {
+      // Records of a truncated or corrupted file are ignored.
+      uint64_t Offset = support::endian::read32le(Entry + 4);
+      StringRef Data = Buffer->getBuffer();
+      if (Offset + RecordHeaderSize > Data.size())
+        return StringRef();
+      uint64_t Size = getRecordSize(Data.data() + Offset);
+      if (Offset + Size > Data.size())
+        return StringRef();
+      return Data.substr(Offset, Size);
+    }
+    if (EntryOpcode < Opcode)
+      Low = Mid + 1;
+    else
+      High = Mid;
+  }
+  return StringRef();
+}
+
+bool InstrDescCache::lookup(unsigned Opcode, unsigned NumOperands,
+                            InstrDescData &ID) const {
+  StringRef Record = getRecord(Opcode);
+  if (Record.empty()) {
+    ++NumCacheMisses;
+    return false;
+  }
+
+  RecordReader R(Record.data());
+  if (R.read32() != NumOperands) {
+    ++NumCacheMisses;
+    return false;
+  }
+
+  ID.MaxLatency = R.read32();
+  ID.NumMicroOps = R.read32();
+  uint32_t Flags = R.read32();
+  ID.MayLoad = Flags & RF_MayLoad;
+  ID.MayStore = Flags & RF_MayStore;
+  ID.HasSideEffects = Flags & RF_HasSideEffects;
+
+  ID.Writes.resize(R.read32());
+  ID.Reads.resize(R.read32());
+  unsigned NumResources = R.read32();
+  ID.Buffers.resize(R.read32());
+
+  for (WriteDescriptor &Write : ID.Writes) {
+    Write.OpIndex = static_cast<int32_t>(R.read32());
+    Write.Latency = R.read32();
+    Write.RegisterID = R.read32();
+    Write.SClassOrWriteResourceID = R.read32();
+    Write.IsOptionalDef = R.read32();
+  }
+
+  for (ReadDescriptor &Read : ID.Reads) {
+    Read.OpIndex = static_cast<int32_t>(R.read32());
+    Read.UseIndex = R.read32();
+    Read.RegisterID = R.read32();
+    Read.SchedClassID = R.read32();
+  }
+
+  ID.Resources.reserve(NumResources);
+  for (unsigned I = 0; I < NumResources; ++I) {
+    uint64_t Mask = R.read64();
+    unsigned Begin = R.read32();
+    unsigned End = R.read32();
+    bool Reserved = R.read32();
+    unsigned NumUnits = R.read32();
+    ID.Resources.emplace_back(
+        Mask, ResourceUsage(CycleSegment(Begin, End, Reserved), NumUnits));
+  }
+
+  for (uint64_t &Buffer : ID.Buffers)
+    Buffer = R.read64();
+
+  ++NumCacheHits;
+  return true;
+}
+
+void InstrDescCache::insert(unsigned Opcode, unsigned NumOperands,
+                            const InstrDesc &ID) {
+  std::string Record;
+  write32(Record, NumOperands);
+  write32(Record, ID.MaxLatency);
+  write32(Record, ID.NumMicroOps);
+  uint32_t Flags = 0;
+  if (ID.MayLoad)
+    Flags |= RF_MayLoad;
+  if (ID.MayStore)
+    Flags |= RF_MayStore;
+  if (ID.HasSideEffects)
+    Flags |= RF_HasSideEffects;
+  write32(Record, Flags);
+  write32(Record, ID.getWrites().size());
+  write32(Record, ID.getReads().size());
+  write32(Record, ID.getResources().size());
+  write32(Record, ID.getBuffers().size());
+
+  for (const WriteDescriptor &Write : ID.getWrites()) {
+    write32(Record, static_cast<uint32_t>(Write.OpIndex));
+    write32(Record, Write.Latency);
+    write32(Record, Write.RegisterID);
+    write32(Record, Write.SClassOrWriteResourceID);
+    write32(Record, Write.IsOptionalDef);
+  }
+
+  for (const ReadDescriptor &Read : ID.getReads()) {
+    write32(Record, static_cast<uint32_t>(Read.OpIndex));
+    write32(Record, Read.UseIndex);
+    write32(Record, Read.RegisterID);
+    write32(Record, Read.SchedClassID);
+  }
+
+  for (const ResourcePlusCycles &Resource : ID.getResources()) {
+    const CycleSegment &CS = Resource.second.CS;
+    write64(Record, Resource.first);
+    write32(Record, CS.begin());
+    write32(Record, CS.end());
+    write32(Record, CS.isReserved());
+    write32(Record, Resource.second.NumUnits);
+  }
+
+  for (uint64_t Buffer : ID.getBuffers())
+    write64(Record, Buffer);
+
+  std::lock_guard<std::mutex> Guard(Lock);
+  NewRecords[Opcode] = std::move(Record);
+}
+
+Error InstrDescCache::save() {
+  std::lock_guard<std::mutex> Guard(Lock);
+  if (NewRecords.empty())
+    return ErrorSuccess();
+
+  // Merge the records loaded from the file with the new ones. New records
+  // replace old records for the same opcode.
+  std::vector<std::pair<unsigned, StringRef>> Records;
+  for (const auto &Entry : NewRecords)
+    Records.emplace_back(Entry.first, Entry.second);
+  for (unsigned I = 0; I < NumEntries; ++I) {
+    unsigned Opcode = support::endian::read32le(Index + I * IndexEntrySize);
+    StringRef Record = getRecord(Opcode);
+    if (!Record.empty() && !NewRecords.count(Opcode))
+      Records.emplace_back(Opcode, Record);
+  }
+  llvm::sort(Records.begin(), Records.end(),
+             [](const std::pair<unsigned, StringRef> &A,
+                const std::pair<unsigned, StringRef> &B) {
+               return A.first < B.first;
+             });
+
+  std::string Data(CacheMagic, 8);
+  write32(Data, CacheFormatVersion);
+  write64(Data, Fingerprint);
+  write32(Data, Key.size());
+  write32(Data, Records.size());
+  Data += Key;
+
+  uint64_t Offset = Data.size() + Records.size() * IndexEntrySize;
+  std::string Body;
+  for (const std::pair<unsigned, StringRef> &Entry : Records) {
+    if (Offset + Body.size() > UINT32_MAX)
+      return make_error<StringError>("instruction descriptor cache too large",
+                                     inconvertibleErrorCode());
+    write32(Data, Entry.first);
+    write32(Data, Offset + Body.size());
+    Body += Entry.second;
+  }
+  Data += Body;
+
+  // Write a temporary file, and then rename it.
+  SmallString<256> TempPath;
+  int FD;
+  if (std::error_code EC =
+          sys::fs::createUniqueFile(Path + ".%%%%%%.tmp", FD, TempPath))
+    return errorCodeToError(EC);
+  {
+    raw_fd_ostream OS(FD, /* shouldClose */ true);
+    OS << Data;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return make_error<StringError>("unable to write " + TempPath,
+                                     inconvertibleErrorCode());
+    }
+  }
+  if (std::error_code EC = sys::fs::rename(TempPath, Path)) {
+    sys::fs::remove(TempPath);
+    return errorCodeToError(EC);
+  }
+
+  NewRecords.clear();
+  return ErrorSuccess();
+}
+
+} // namespace mca
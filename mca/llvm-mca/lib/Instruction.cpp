@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "Instruction.h"
+#include "StateSignature.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -20,6 +21,49 @@ namespace mca {
 
 using namespace llvm;
 
+void InstrDescData::clear() {
+  Writes.clear();
+  Reads.clear();
+  Resources.clear();
+  Buffers.clear();
+  MaxLatency = 0;
+  NumMicroOps = 0;
+  MayLoad = false;
+  MayStore = false;
+  HasSideEffects = false;
+}
+
+InstrDesc::InstrDesc(const InstrDescData &Data)
+    : MaxLatency(Data.MaxLatency), NumMicroOps(Data.NumMicroOps),
+      MayLoad(Data.MayLoad), MayStore(Data.MayStore),
+      HasSideEffects(Data.HasSideEffects), NumResources(Data.Resources.size()),
+      NumBuffers(Data.Buffers.size()), NumWrites(Data.Writes.size()),
+      NumReads(Data.Reads.size()) {
+  std::uninitialized_copy(Data.Resources.begin(), Data.Resources.end(),
+                          getTrailingObjects<ResourcePlusCycles>());
+  std::uninitialized_copy(Data.Buffers.begin(), Data.Buffers.end(),
+                          getTrailingObjects<uint64_t>());
+  std::uninitialized_copy(Data.Writes.begin(), Data.Writes.end(),
+                          getTrailingObjects<WriteDescriptor>());
+  std::uninitialized_copy(Data.Reads.begin(), Data.Reads.end(),
+                          getTrailingObjects<ReadDescriptor>());
+}
+
+const InstrDesc *InstrDesc::create(BumpPtrAllocator &Alloc,
+                                   const InstrDescData &Data) {
+  // The arena never runs destructors.
+  static_assert(std::is_trivially_destructible<ResourcePlusCycles>::value &&
+                    std::is_trivially_destructible<WriteDescriptor>::value &&
+                    std::is_trivially_destructible<ReadDescriptor>::value,
+                "Descriptors must be trivially destructible!");
+  size_t Size = totalSizeToAlloc<ResourcePlusCycles, uint64_t, WriteDescriptor,
+                                 ReadDescriptor>(
+      Data.Resources.size(), Data.Buffers.size(), Data.Writes.size(),
+      Data.Reads.size());
+  void *Mem = Alloc.Allocate(Size, alignof(ResourcePlusCycles));
+  return new (Mem) InstrDesc(Data);
+}
+
 void ReadState::writeStartEvent(unsigned Cycles) {
   assert(DependentWrites);
   assert(CyclesLeft == UNKNOWN_CYCLES);
@@ -62,8 +106,11 @@ void WriteState::addUser(ReadState *User, int ReadAdvance) {
     return;
   }
 
-  std::pair<ReadState *, int> NewPair(User, ReadAdvance);
-  Users.insert(NewPair);
+  assert(llvm::find_if(Users, [User](const std::pair<ReadState *, int> &Use) {
+           return Use.first == User;
+         }) == Users.end() && "Read already registered!");
+  Users.emplace_back(User, ReadAdvance);
+  User->addPendingWrite(this);
 }
 
 void WriteState::cycleEvent() {
@@ -74,6 +121,31 @@ void WriteState::cycleEvent() {
     CyclesLeft--;
 }
 
+void WriteState::skipCycles(unsigned NumCycles) {
+  if (CyclesLeft != UNKNOWN_CYCLES)
+    CyclesLeft -= NumCycles;
+}
+
+void WriteState::releaseWriteUsers() {
+  for (WriteState *User : WriteUsers) {
+    assert(User->DependentWrite == this && "Inconsistent WAW dependency!");
+    User->DependentWrite = nullptr;
+  }
+  WriteUsers.clear();
+}
+
+void WriteState::encodeState(StateSignature &S) const {
+  S.add(CyclesLeft);
+  S.add(getNumUsers());
+}
+
+void ReadState::encodeState(StateSignature &S) const {
+  S.add(DependentWrites);
+  S.add(CyclesLeft);
+  S.add(TotalCycles);
+  S.add(IsReady);
+}
+
 void ReadState::cycleEvent() {
   // Update the total number of cycles.
   if (DependentWrites && TotalCycles) {
@@ -91,6 +163,22 @@ void ReadState::cycleEvent() {
   }
 }
 
+void ReadState::skipCycles(unsigned NumCycles) {
+  if (DependentWrites) {
+    // CyclesLeft is only known once all the dependent writes have been issued.
+    TotalCycles -= std::min(TotalCycles, NumCycles);
+    return;
+  }
+
+  if (CyclesLeft == UNKNOWN_CYCLES)
+    return;
+
+  if (CyclesLeft) {
+    CyclesLeft -= std::min(static_cast<unsigned>(CyclesLeft), NumCycles);
+    IsReady = !CyclesLeft;
+  }
+}
+
 #ifndef NDEBUG
 void WriteState::dump() const {
   dbgs() << "{ OpIdx=" << WD.OpIndex << ", Lat=" << getLatency() << ", RegID "
@@ -106,6 +194,22 @@ void WriteRef::dump() const {
 }
 #endif
 
+void Instruction::reset(const InstrDesc &D) {
+  assert(llvm::none_of(Defs,
+                       [](const WriteState &Def) {
+                         return Def.getDependentWriteUsers().size();
+                       }) &&
+         "Register writes still have dependent writes!");
+  Defs.clear();
+  Uses.clear();
+
+  Desc = &D;
+  Stage = IS_INVALID;
+  CyclesLeft = UNKNOWN_CYCLES;
+  RCUTokenID = 0;
+  IsDepBreaking = false;
+}
+
 void Instruction::dispatch(unsigned RCUToken) {
   assert(Stage == IS_INVALID);
   Stage = IS_AVAILABLE;
@@ -120,10 +224,10 @@ void Instruction::execute() {
   Stage = IS_EXECUTING;
 
   // Set the cycles left before the write-back stage.
-  CyclesLeft = Desc.MaxLatency;
+  CyclesLeft = Desc->MaxLatency;
 
-  for (UniqueDef &Def : Defs)
-    Def->onInstructionIssued();
+  for (WriteState &Def : Defs)
+    Def.onInstructionIssued();
 
   // Transition to the "executed" stage if this is a zero-latency instruction.
   if (!CyclesLeft)
@@ -133,16 +237,16 @@ void Instruction::execute() {
 void Instruction::update() {
   assert(isDispatched() && "Unexpected instruction stage found!");
 
-  if (!llvm::all_of(Uses, [](const UniqueUse &Use) { return Use->isReady(); }))
+  if (!llvm::all_of(Uses, [](const ReadState &Use) { return Use.isReady(); }))
     return;
 
   // A partial register write cannot complete before a dependent write.
-  auto IsDefReady = [&](const UniqueDef &Def) {
-    if (const WriteState *Write = Def->getDependentWrite()) {
+  auto IsDefReady = [&](const WriteState &Def) {
+    if (const WriteState *Write = Def.getDependentWrite()) {
       int WriteLatency = Write->getCyclesLeft();
       if (WriteLatency == UNKNOWN_CYCLES)
         return false;
-      return static_cast<unsigned>(WriteLatency) < Desc.MaxLatency;
+      return static_cast<unsigned>(WriteLatency) < Desc->MaxLatency;
     }
     return true;
   };
@@ -156,8 +260,8 @@ void Instruction::cycleEvent() {
     return;
 
   if (isDispatched()) {
-    for (UniqueUse &Use : Uses)
-      Use->cycleEvent();
+    for (ReadState &Use : Uses)
+      Use.cycleEvent();
 
     update();
     return;
@@ -165,13 +269,74 @@ void Instruction::cycleEvent() {
 
   assert(isExecuting() && "Instruction not in-flight?");
   assert(CyclesLeft && "Instruction already executed?");
-  for (UniqueDef &Def : Defs)
-    Def->cycleEvent();
+  for (WriteState &Def : Defs)
+    Def.cycleEvent();
   CyclesLeft--;
   if (!CyclesLeft)
     Stage = IS_EXECUTED;
 }
 
+unsigned Instruction::getNumIdleCycles() const {
+  if (isExecuting())
+    return CyclesLeft - 1;
+
+  if (!isDispatched())
+    return UNBOUNDED_IDLE_CYCLES;
+
+  // Compute the first cycle in which all the input operands are ready.
+  unsigned ReadyCycle = 0;
+  for (const ReadState &Use : Uses) {
+    if (Use.isReady())
+      continue;
+    // Reads that depend on writes which have not been issued yet can only
+    // become ready in response to an issue event.
+    int UseCyclesLeft = Use.getCyclesLeft();
+    if (UseCyclesLeft == UNKNOWN_CYCLES)
+      return UNBOUNDED_IDLE_CYCLES;
+    ReadyCycle = std::max(ReadyCycle, static_cast<unsigned>(UseCyclesLeft));
+  }
+
+  // A partial register write cannot complete before a dependent write (see
+  // method update()).
+  for (const WriteState &Def : Defs) {
+    if (const WriteState *Write = Def.getDependentWrite()) {
+      int WriteLatency = Write->getCyclesLeft();
+      if (WriteLatency == UNKNOWN_CYCLES)
+        return UNBOUNDED_IDLE_CYCLES;
+      if (WriteLatency >= static_cast<int>(Desc->MaxLatency))
+        ReadyCycle = std::max(ReadyCycle, WriteLatency - Desc->MaxLatency + 1);
+    }
+  }
+
+  return ReadyCycle ? ReadyCycle - 1 : 0;
+}
+
+void Instruction::skipCycles(unsigned NumCycles) {
+  assert(NumCycles <= getNumIdleCycles() && "Skipping too many cycles!");
+  if (isReady())
+    return;
+
+  if (isDispatched()) {
+    for (ReadState &Use : Uses)
+      Use.skipCycles(NumCycles);
+    return;
+  }
+
+  assert(isExecuting() && "Instruction not in-flight?");
+  for (WriteState &Def : Defs)
+    Def.skipCycles(NumCycles);
+  CyclesLeft -= NumCycles;
+}
+
+void Instruction::encodeState(StateSignature &S) const {
+  S.add(Stage);
+  S.add(CyclesLeft);
+  for (const ReadState &Use : Uses)
+    Use.encodeState(S);
+  for (const WriteState &Def : Defs)
+    Def.encodeState(S);
+}
+
 const unsigned WriteRef::INVALID_IID = std::numeric_limits<unsigned>::max();
 
 } // namespace mca
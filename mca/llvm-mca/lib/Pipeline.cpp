@@ -15,6 +15,7 @@
 
 #include "Pipeline.h"
 #include "HWEventListener.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/CodeGen/TargetSchedule.h"
 #include "llvm/Support/Debug.h"
 
@@ -25,12 +26,19 @@ namespace mca {
 using namespace llvm;
 
 void Pipeline::addEventListener(HWEventListener *Listener) {
-  if (Listener)
-    Listeners.insert(Listener);
+  if (!Listener)
+    return;
+  Listeners.add(Listener);
   for (auto &S : Stages)
     S->addListener(Listener);
 }
 
+void Pipeline::setProfiler(PipelineProfiler &P) {
+  Profiler = &P;
+  for (const std::unique_ptr<Stage> &S : Stages)
+    S->setProfiler(Profiler, Profiler->addStage(S->getName()));
+}
+
 bool Pipeline::hasWorkToProcess() {
   return llvm::any_of(Stages, [](const std::unique_ptr<Stage> &S) {
     return S->hasWorkToComplete();
@@ -40,16 +48,145 @@ bool Pipeline::hasWorkToProcess() {
 llvm::Error Pipeline::run() {
   assert(!Stages.empty() && "Unexpected empty pipeline found!");
 
+  // Time not spent in a stage or in a listener is charged to the pipeline.
+  Optional<PipelineProfiler::Scope> ProfileScope;
+  if (Profiler)
+    ProfileScope.emplace(*Profiler, Profiler->getPipelineCounter());
+
   while (hasWorkToProcess()) {
     notifyCycleBegin();
-    if (llvm::Error Err = runCycle())
+    if (llvm::Error Err = Profiler ? runProfiledCycle() : runCycle())
       return Err;
     notifyCycleEnd();
     ++Cycles;
+    if (SteadyStateSource)
+      checkSteadyState();
+    if (EventDriven && hasWorkToProcess())
+      skipIdleCycles();
   }
   return llvm::ErrorSuccess();
 }
 
+void Pipeline::skipIdleCycles() {
+  unsigned NumCycles = UNBOUNDED_IDLE_CYCLES;
+  for (const std::unique_ptr<Stage> &S : Stages) {
+    NumCycles = std::min(NumCycles, S->getNumIdleCycles());
+    if (!NumCycles)
+      return;
+  }
+
+  // There is still work to process, so at least one stage should be waiting on
+  // a timed event. Conservatively fall back to simulating the next cycle.
+  if (NumCycles == UNBOUNDED_IDLE_CYCLES)
+    return;
+  LLVM_DEBUG(dbgs() << "[E] Skipping " << NumCycles << " idle cycles\n");
+
+  for (const std::unique_ptr<Stage> &S : Stages)
+    S->skipCycles(NumCycles);
+
+  // Listeners must observe the same sequence of events that would have been
+  // generated by a cycle-by-cycle simulation. During idle cycles, the only
+  // events generated are dispatch stalls, which are replayed by probing the
+  // first stage of the pipeline.
+  InstRef IR;
+  Stage &FirstStage = *Stages[0];
+  for (unsigned I = 0; I < NumCycles; ++I) {
+    notifyCycleBegin();
+    bool IsAvailable = FirstStage.isAvailable(IR);
+    (void)IsAvailable;
+    assert(!IsAvailable && "Unexpected dispatch in an idle cycle!");
+    notifyCycleEnd();
+    ++Cycles;
+  }
+}
+
+void Pipeline::checkSteadyState() {
+  SourceMgr &SM = *SteadyStateSource;
+  if (!SM.hasNext()) {
+    // There is nothing left to extrapolate.
+    SteadyStateSource = nullptr;
+    return;
+  }
+
+  // Only check the state at iteration boundaries. If a period is being
+  // verified, then only its last iteration boundary is interesting.
+  unsigned Iteration = SM.getCurrentIteration();
+  if (Iteration == LastIteration)
+    return;
+  LastIteration = Iteration;
+  if (PeriodStartState && Iteration < PeriodStart.Iteration + Period)
+    return;
+
+  auto State = llvm::make_unique<StateSignature>(Iteration * SM.size());
+  for (const std::unique_ptr<Stage> &S : Stages)
+    S->encodeState(*State);
+
+  if (PeriodStartState) {
+    if (*State == *PeriodStartState) {
+      extrapolatePeriod();
+      return;
+    }
+    // Hash collision, or the state at the beginning of the period was not yet
+    // reachable from itself. Keep searching.
+    LLVM_DEBUG(dbgs() << "[E] Steady-state period of " << Period
+                      << " iterations not confirmed at iteration " << Iteration
+                      << '\n');
+    PeriodStartState.reset();
+  }
+
+  // Drop one bit so that the hash never collides with the empty and tombstone
+  // keys of the DenseMap.
+  size_t Hash = static_cast<size_t>(State->hash()) >> 1;
+  auto It = Checkpoints.find(Hash);
+  if (It != Checkpoints.end()) {
+    Period = Iteration - It->second.Iteration;
+    // Verifying the period only pays off if at least one more repetition of
+    // it can be extrapolated afterwards.
+    if (SM.getNumInstructionsLeft() > 2 * Period * SM.size()) {
+      LLVM_DEBUG(dbgs() << "[E] Candidate steady-state period of " << Period
+                        << " iterations at iteration " << Iteration << '\n');
+      PeriodStart = {Iteration, Cycles};
+      PeriodStartState = std::move(State);
+      notifyListeners(Listeners.get(HWEventListener::PeriodBoundary), Profiler,
+                      [](HWEventListener &Listener) {
+                        Listener.onPeriodBegin();
+                      });
+    }
+    It->second = {Iteration, Cycles};
+    return;
+  }
+
+  if (Checkpoints.size() == MaxCheckpoints) {
+    LLVM_DEBUG(dbgs() << "[E] No steady-state found.\n");
+    SteadyStateSource = nullptr;
+    Checkpoints.clear();
+    return;
+  }
+  Checkpoints[Hash] = {Iteration, Cycles};
+}
+
+void Pipeline::extrapolatePeriod() {
+  SourceMgr &SM = *SteadyStateSource;
+  unsigned PeriodCycles = Cycles - PeriodStart.Cycle;
+  unsigned PeriodSize = Period * SM.size();
+  unsigned NumRepeats = (SM.getNumInstructionsLeft() - 1) / PeriodSize;
+  LLVM_DEBUG(dbgs() << "[E] Steady-state period of " << Period
+                    << " iterations (" << PeriodCycles << " cycles) repeated "
+                    << NumRepeats << " times\n");
+
+  notifyListeners(Listeners.get(HWEventListener::PeriodBoundary), Profiler,
+                  [&](HWEventListener &Listener) {
+                    Listener.onPeriodEnd(NumRepeats);
+                  });
+  if (NumRepeats)
+    SM.skipIterations(NumRepeats * Period);
+  Cycles += NumRepeats * PeriodCycles;
+
+  SteadyStateSource = nullptr;
+  Checkpoints.clear();
+  PeriodStartState.reset();
+}
+
 llvm::Error Pipeline::runCycle() {
   llvm::Error Err = llvm::ErrorSuccess();
   // Update stages before we start processing new instructions.
@@ -73,6 +210,36 @@ llvm::Error Pipeline::runCycle() {
   return Err;
 }
 
+// Same as runCycle(), but the time spent in every stage is charged to the
+// counter of the stage. Stages called through Stage::moveToTheNextStage() are
+// accounted by the caller stage.
+llvm::Error Pipeline::runProfiledCycle() {
+  llvm::Error Err = llvm::ErrorSuccess();
+  auto GetCounter = [&](const Stage &S) -> PipelineProfiler::Counter & {
+    return Profiler->getStageCounter(S.getProfileIndex());
+  };
+
+  for (auto I = Stages.rbegin(), E = Stages.rend(); I != E && !Err; ++I) {
+    PipelineProfiler::Scope S(*Profiler, GetCounter(**I));
+    Err = (*I)->cycleStart();
+  }
+
+  InstRef IR;
+  Stage &FirstStage = *Stages[0];
+  if (!Err) {
+    PipelineProfiler::Scope S(*Profiler, GetCounter(FirstStage));
+    while (!Err && FirstStage.isAvailable(IR))
+      Err = FirstStage.execute(IR);
+  }
+
+  for (auto I = Stages.rbegin(), E = Stages.rend(); I != E && !Err; ++I) {
+    PipelineProfiler::Scope S(*Profiler, GetCounter(**I));
+    Err = (*I)->cycleEnd();
+  }
+
+  return Err;
+}
+
 void Pipeline::appendStage(std::unique_ptr<Stage> S) {
   assert(S && "Invalid null stage in input!");
   if (!Stages.empty()) {
@@ -85,13 +252,13 @@ void Pipeline::appendStage(std::unique_ptr<Stage> S) {
 
 void Pipeline::notifyCycleBegin() {
   LLVM_DEBUG(dbgs() << "[E] Cycle begin: " << Cycles << '\n');
-  for (HWEventListener *Listener : Listeners)
-    Listener->onCycleBegin();
+  notifyListeners(Listeners.get(HWEventListener::CycleBegin), Profiler,
+                  [](HWEventListener &Listener) { Listener.onCycleBegin(); });
 }
 
 void Pipeline::notifyCycleEnd() {
   LLVM_DEBUG(dbgs() << "[E] Cycle end: " << Cycles << "\n\n");
-  for (HWEventListener *Listener : Listeners)
-    Listener->onCycleEnd();
+  notifyListeners(Listeners.get(HWEventListener::CycleEnd), Profiler,
+                  [](HWEventListener &Listener) { Listener.onCycleEnd(); });
 }
 } // namespace mca.
@@ -0,0 +1,28 @@
+//===--------------------- PipelineProfiler.cpp -----------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements class PipelineProfiler.
+///
+//===----------------------------------------------------------------------===//
+
+#include "PipelineProfiler.h"
+
+namespace mca {
+
+PipelineProfiler::Counter &
+PipelineProfiler::getListenerCounter(const HWEventListener &Listener) {
+  unsigned Index = ListenerCounters.size();
+  auto Result = ListenerIndices.insert(std::make_pair(&Listener, Index));
+  if (Result.second)
+    ListenerCounters.emplace_back(Listener.getName());
+  return ListenerCounters[Result.first->second];
+}
+
+} // namespace mca
@@ -19,6 +19,7 @@
 #include "Stages/DispatchStage.h"
 #include "HWEventListener.h"
 #include "HardwareUnits/Scheduler.h"
+#include "StateSignature.h"
 #include "llvm/Support/Debug.h"
 
 using namespace llvm;
@@ -35,21 +36,51 @@ void DispatchStage::notifyInstructionDispatched(const InstRef &IR,
       HWInstructionDispatchedEvent(IR, UsedRegs, UOps));
 }
 
+unsigned DispatchStage::getPRFCostIndex(const Instruction &IS) const {
+  const Instruction::VecDefs &Defs = IS.getDefs();
+  SmallVectorImpl<PRFCostEntry> &Entries = PRFCostCache[&IS.getDesc()];
+  for (const PRFCostEntry &Entry : Entries) {
+    if (Entry.RegDefs.size() == Defs.size() &&
+        std::equal(Defs.begin(), Defs.end(), Entry.RegDefs.begin(),
+                   [](const WriteState &WS, unsigned RegID) {
+                     return WS.getRegisterID() == RegID;
+                   }))
+      return Entry.CostIndex;
+  }
+
+  PRFCostEntry Entry;
+  for (const WriteState &RegDef : Defs)
+    Entry.RegDefs.emplace_back(RegDef.getRegisterID());
+  unsigned NumRegisterFiles = PRF.getNumRegisterFiles();
+  Entry.CostIndex = PRFCosts.size();
+  PRFCosts.resize(PRFCosts.size() + NumRegisterFiles);
+  MutableArrayRef<unsigned> Cost(&PRFCosts[Entry.CostIndex], NumRegisterFiles);
+  PRF.getRegisterCosts(Entry.RegDefs, Cost);
+  Entries.emplace_back(std::move(Entry));
+  return Entries.back().CostIndex;
+}
+
 bool DispatchStage::checkPRF(const InstRef &IR) const {
-  SmallVector<unsigned, 4> RegDefs;
-  for (const std::unique_ptr<WriteState> &RegDef :
-       IR.getInstruction()->getDefs())
-    RegDefs.emplace_back(RegDef->getRegisterID());
-
-  const unsigned RegisterMask = PRF.isAvailable(RegDefs);
-  // A mask with all zeroes means: register files are available.
-  if (RegisterMask) {
-    notifyEvent<HWStallEvent>(
-        HWStallEvent(HWStallEvent::RegisterFileStall, IR));
-    return false;
+  const Instruction &IS = *IR.getInstruction();
+  // Instructions that don't define registers never stall.
+  if (IS.getDefs().empty())
+    return true;
+
+  unsigned CostIndex = getPRFCostIndex(IS);
+  unsigned Generation = PRF.getPhysRegsGeneration();
+  if (CostIndex != LastPRFStallCost || Generation != LastPRFStallGeneration) {
+    ArrayRef<unsigned> Cost(&PRFCosts[CostIndex], PRF.getNumRegisterFiles());
+    const unsigned RegisterMask = PRF.isAvailable(Cost);
+    // A mask with all zeroes means: register files are available.
+    if (!RegisterMask)
+      return true;
+    LastPRFStallCost = CostIndex;
+    LastPRFStallGeneration = Generation;
   }
 
-  return true;
+  notifyEvent<HWStallEvent>(
+      HWStallEvent(HWStallEvent::RegisterFileStall, IR));
+  return false;
 }
 
 bool DispatchStage::checkRCU(const InstRef &IR) const {
@@ -107,9 +138,9 @@ llvm::Error DispatchStage::dispatch(InstRef IR) {
   // instruction that doesn't consume hardware resources.
   // An example of dependency-breaking instruction on X86 is a zero-idiom XOR.
   bool IsDependencyBreaking = IS.isDependencyBreaking();
-  for (std::unique_ptr<ReadState> &RS : IS.getUses())
-    if (RS->isImplicitRead() || !IsDependencyBreaking)
-      updateRAWDependencies(*RS, STI);
+  for (ReadState &RS : IS.getUses())
+    if (RS.isImplicitRead() || !IsDependencyBreaking)
+      updateRAWDependencies(RS, STI);
 
   // By default, a dependency-breaking zero-latency instruction is expected to
   // be optimized at register renaming stage. That means, no physical register
@@ -117,8 +148,8 @@ llvm::Error DispatchStage::dispatch(InstRef IR) {
   bool ShouldAllocateRegisters =
       !(Desc.isZeroLatency() && IsDependencyBreaking);
   SmallVector<unsigned, 4> RegisterFiles(PRF.getNumRegisterFiles());
-  for (std::unique_ptr<WriteState> &WS : IS.getDefs()) {
-    PRF.addRegisterWrite(WriteRef(IR.first, WS.get()), RegisterFiles,
+  for (WriteState &WS : IS.getDefs()) {
+    PRF.addRegisterWrite(WriteRef(IR.first, &WS), RegisterFiles,
                          ShouldAllocateRegisters);
   }
 
@@ -151,6 +182,15 @@ llvm::Error DispatchStage::cycleStart() {
   return llvm::ErrorSuccess();
 }
 
+void DispatchStage::encodeState(StateSignature &S) const {
+  S.add(AvailableEntries);
+  S.add(CarryOver);
+  if (CarryOver)
+    S.addIndex(CarriedOver.getSourceIndex());
+  RCU.encodeState(S);
+  PRF.encodeState(S);
+}
+
 bool DispatchStage::isAvailable(const InstRef &IR) const {
   const InstrDesc &Desc = IR.getInstruction()->getDesc();
   unsigned Required = std::min(Desc.NumMicroOps, DispatchWidth);
@@ -55,10 +55,13 @@ bool ExecuteStage::isAvailable(const InstRef &IR) const {
 Error ExecuteStage::issueInstruction(InstRef &IR) {
   SmallVector<std::pair<ResourceRef, double>, 4> Used;
   SmallVector<InstRef, 4> Ready;
-  HWS.issueInstruction(IR, Used, Ready);
+  // The list of used resources is only computed if somebody observes it.
+  bool NotifyIssued = hasListeners(HWEventListener::InstructionIssued);
+  HWS.issueInstruction(IR, NotifyIssued ? &Used : nullptr, Ready);
 
   notifyReservedOrReleasedBuffers(IR, /* Reserved */false);
-  notifyInstructionIssued(IR, Used);
+  if (NotifyIssued)
+    notifyInstructionIssued(IR, Used);
   if (IR.getInstruction()->isExecuted()) {
     notifyInstructionExecuted(IR);
     // FIXME: add a buffer of executed instructions.
@@ -151,8 +154,9 @@ void ExecuteStage::notifyInstructionReady(const InstRef &IR) {
 void ExecuteStage::notifyResourceAvailable(const ResourceRef &RR) {
   LLVM_DEBUG(dbgs() << "[E] Resource Available: [" << RR.first << '.'
                     << RR.second << "]\n");
-  for (HWEventListener *Listener : getListeners())
-    Listener->onResourceAvailable(RR);
+  notifyListeners(
+      getListeners(HWEventListener::ResourceAvailable), getProfiler(),
+      [&](HWEventListener &Listener) { Listener.onResourceAvailable(RR); });
 }
 
 void ExecuteStage::notifyInstructionIssued(
@@ -170,21 +174,26 @@ void ExecuteStage::notifyInstructionIssued(
 
 void ExecuteStage::notifyReservedOrReleasedBuffers(const InstRef &IR,
                                                    bool Reserved) {
-  const InstrDesc &Desc = IR.getInstruction()->getDesc();
-  if (Desc.Buffers.empty())
+  EventKind Kind = Reserved ? HWEventListener::ReservedBuffers
+                            : HWEventListener::ReleasedBuffers;
+  if (!hasListeners(Kind))
     return;
 
-  SmallVector<unsigned, 4> BufferIDs(Desc.Buffers.begin(), Desc.Buffers.end());
-  std::transform(Desc.Buffers.begin(), Desc.Buffers.end(), BufferIDs.begin(),
-                 [&](uint64_t Op) { return HWS.getResourceID(Op); });
-  if (Reserved) {
-    for (HWEventListener *Listener : getListeners())
-      Listener->onReservedBuffers(IR, BufferIDs);
+  const InstrDesc &Desc = IR.getInstruction()->getDesc();
+  ArrayRef<uint64_t> Buffers = Desc.getBuffers();
+  if (Buffers.empty())
     return;
-  }
 
-  for (HWEventListener *Listener : getListeners())
-    Listener->onReleasedBuffers(IR, BufferIDs);
+  SmallVector<unsigned, 4> BufferIDs(Buffers.begin(), Buffers.end());
+  std::transform(Buffers.begin(), Buffers.end(), BufferIDs.begin(),
+                 [&](uint64_t Op) { return HWS.getResourceID(Op); });
+  notifyListeners(getListeners(Kind), getProfiler(),
+                  [&](HWEventListener &Listener) {
+                    if (Reserved)
+                      Listener.onReservedBuffers(IR, BufferIDs);
+                    else
+                      Listener.onReleasedBuffers(IR, BufferIDs);
+                  });
 }
 
 } // namespace mca
@@ -14,9 +14,29 @@
 //===----------------------------------------------------------------------===//
 
 #include "Stages/FetchStage.h"
+#include "StateSignature.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Statistic.h"
+
+#define DEBUG_TYPE "llvm-mca"
+
+STATISTIC(MaxWindowOccupancy,
+          "Maximum number of in-flight instructions in the fetch window");
+STATISTIC(NumWindowResizes, "Number of times the fetch window was resized");
 
 namespace mca {
 
+FetchStage::~FetchStage() {
+  // Instructions that were never retired (for example, every instruction
+  // simulated by the InstructionTables stage) are still owned by this stage.
+  // Return them to the InstrBuilder, so that it doesn't count them as in
+  // flight once the pipeline is gone.
+  if (CurrentInstruction)
+    IB.recycleInstruction(std::move(CurrentInstruction));
+  for (; WindowSize; ++WindowStart, --WindowSize)
+    IB.recycleInstruction(std::move(getWindowEntry(WindowStart)));
+}
+
 bool FetchStage::hasWorkToComplete() const {
   return CurrentInstruction.get() || SM.hasNext();
 }
@@ -49,7 +69,7 @@ llvm::Error FetchStage::execute(InstRef & /*unused */) {
   InstRef IR(SR.first, CurrentInstruction.get());
   assert(checkNextStage(IR) && "Invalid fetch!");
 
-  Instructions[IR.getSourceIndex()] = std::move(CurrentInstruction);
+  addToWindow(IR.getSourceIndex(), std::move(CurrentInstruction));
   if (llvm::Error Val = moveToTheNextStage(IR))
     return Val;
 
@@ -65,16 +85,107 @@ llvm::Error FetchStage::cycleStart() {
   return llvm::ErrorSuccess();
 }
 
+unsigned FetchStage::getNumIdleCycles() const {
+  // A new instruction is fetched at the beginning of the next cycle.
+  if (!CurrentInstruction && SM.hasNext())
+    return 0;
+  return UNBOUNDED_IDLE_CYCLES;
+}
+
+void FetchStage::addToWindow(unsigned SourceIndex,
+                             std::unique_ptr<Instruction> IS) {
+  if (!WindowSize)
+    WindowStart = SourceIndex;
+  assert(SourceIndex == WindowStart + WindowSize &&
+         "Instructions must be fetched in program order!");
+
+  if (WindowSize == Window.size()) {
+    // Double the size of the window, and move in-flight instructions to their
+    // new slots.
+    std::vector<std::unique_ptr<Instruction>> OldWindow(std::move(Window));
+    Window.clear();
+    Window.resize(OldWindow.empty() ? 64 : OldWindow.size() * 2);
+    for (unsigned I = WindowStart, E = WindowStart + WindowSize; I != E; ++I)
+      getWindowEntry(I) = std::move(OldWindow[I & (OldWindow.size() - 1)]);
+    ++NumWindowResizes;
+  }
+
+  getWindowEntry(SourceIndex) = std::move(IS);
+  ++WindowSize;
+  if (WindowSize > MaxWindowOccupancy)
+    MaxWindowOccupancy = WindowSize;
+}
+
+void FetchStage::encodeState(StateSignature &S) const {
+  S.add(SM.hasNext());
+  if (SM.hasNext())
+    S.addIndex(SM.peekNext().first);
+  S.add(CurrentInstruction != nullptr);
+
+  // Register operands are identified by the source index of the owning
+  // instruction, and by their position in the list of operands.
+  using OperandPosition = std::pair<unsigned, unsigned>;
+  llvm::DenseMap<const ReadState *, OperandPosition> ReadPositions;
+  llvm::DenseMap<const WriteState *, OperandPosition> WritePositions;
+  const unsigned WindowEnd = WindowStart + WindowSize;
+  for (unsigned I = WindowStart; I != WindowEnd; ++I) {
+    const Instruction &IS = getWindowEntry(I);
+    unsigned Position = 0;
+    for (const ReadState &Use : IS.getUses())
+      ReadPositions[&Use] = std::make_pair(I, Position++);
+    Position = 0;
+    for (const WriteState &Def : IS.getDefs())
+      WritePositions[&Def] = std::make_pair(I, Position++);
+  }
+
+  auto EncodePosition = [&S](const OperandPosition &Position) {
+    S.addIndex(Position.first);
+    S.add(Position.second);
+  };
+
+  S.add(WindowSize);
+  for (unsigned I = WindowStart; I != WindowEnd; ++I) {
+    const Instruction &IS = getWindowEntry(I);
+    S.addIndex(I);
+    IS.encodeState(S);
+
+    for (const WriteState &Def : IS.getDefs()) {
+      // Partial writes of retired instructions are released when the owning
+      // instruction is recycled, so dependent writes are always in the window.
+      const WriteState *DependentWrite = Def.getDependentWrite();
+      S.add(DependentWrite != nullptr);
+      if (DependentWrite) {
+        auto It = WritePositions.find(DependentWrite);
+        assert(It != WritePositions.end() && "Write not in flight!");
+        EncodePosition(It->second);
+      }
+
+      // Only users of writes that have not been issued yet are notified in
+      // the future.
+      if (Def.getCyclesLeft() != UNKNOWN_CYCLES)
+        continue;
+      for (const std::pair<ReadState *, int> &User : Def.getUsers()) {
+        auto It = ReadPositions.find(User.first);
+        assert(It != ReadPositions.end() && "Read not in flight!");
+        EncodePosition(It->second);
+        S.add(User.second);
+      }
+    }
+  }
+}
+
 llvm::Error FetchStage::cycleEnd() {
-  // Find the first instruction which hasn't been retired.
-  const InstMap::iterator It =
-      llvm::find_if(Instructions, [](const InstMap::value_type &KeyValuePair) {
-        return !KeyValuePair.second->isRetired();
-      });
-
-  // Erase instructions up to the first that hasn't been retired.
-  if (It != Instructions.begin())
-    Instructions.erase(Instructions.begin(), It);
+  // Remove instructions up to the first that hasn't been retired. Retired
+  // instructions are returned to the InstrBuilder in program order, so that
+  // their storage can be reused by instructions fetched later on.
+  while (WindowSize) {
+    std::unique_ptr<Instruction> &Entry = getWindowEntry(WindowStart);
+    if (!Entry->isRetired())
+      break;
+    IB.recycleInstruction(std::move(Entry));
+    ++WindowStart;
+    --WindowSize;
+  }
 
   return llvm::ErrorSuccess();
 }
@@ -22,12 +22,15 @@ namespace mca {
 using namespace llvm;
 
 Error InstructionTables::execute(InstRef &IR) {
+  if (!hasListeners(HWEventListener::InstructionIssued))
+    return ErrorSuccess();
+
   ArrayRef<uint64_t> Masks = IB.getProcResourceMasks();
   const InstrDesc &Desc = IR.getInstruction()->getDesc();
   UsedResources.clear();
 
   // Identify the resources consumed by this instruction.
-  for (const std::pair<uint64_t, ResourceUsage> Resource : Desc.Resources) {
+  for (const ResourcePlusCycles &Resource : Desc.getResources()) {
     // Skip zero-cycle resources (i.e., unused resources).
     if (!Resource.second.size())
       continue;
@@ -42,6 +42,14 @@ llvm::Error RetireStage::cycleStart() {
   return llvm::ErrorSuccess();
 }
 
+unsigned RetireStage::getNumIdleCycles() const {
+  // Tokens are marked as executed by method execute(). Until then, there is
+  // nothing to retire.
+  if (RCU.isEmpty() || !RCU.peekCurrentToken().Executed)
+    return UNBOUNDED_IDLE_CYCLES;
+  return 0;
+}
+
 llvm::Error RetireStage::execute(InstRef &IR) {
   RCU.onInstructionExecuted(IR.getInstruction()->getRCUTokenID());
   return llvm::ErrorSuccess();
@@ -54,8 +62,8 @@ void RetireStage::notifyInstructionRetired(const InstRef &IR) {
   const InstrDesc &Desc = Inst.getDesc();
 
   bool ShouldFreeRegs = !(Desc.isZeroLatency() && Inst.isDependencyBreaking());
-  for (const std::unique_ptr<WriteState> &WS : Inst.getDefs())
-    PRF.removeRegisterWrite(*WS.get(), FreedRegs, ShouldFreeRegs);
+  for (const WriteState &WS : Inst.getDefs())
+    PRF.removeRegisterWrite(WS, FreedRegs, ShouldFreeRegs);
   notifyEvent<HWInstructionEvent>(HWInstructionRetiredEvent(IR, FreedRegs));
 }
 
@@ -21,7 +21,13 @@ namespace mca {
 Stage::~Stage() = default;
 
 void Stage::addListener(HWEventListener *Listener) {
-  Listeners.insert(Listener);
+  Listeners.add(Listener);
+}
+
+llvm::Error Stage::moveToTheNextStageProfiled(InstRef &IR) {
+  PipelineProfiler::Scope S(
+      *Profiler, Profiler->getStageCounter(NextInSequence->getProfileIndex()));
+  return NextInSequence->execute(IR);
 }
 
 } // namespace mca
@@ -22,19 +22,26 @@
 //===----------------------------------------------------------------------===//
 
 #include "CodeRegion.h"
+#include "Corpus.h"
 #include "PipelinePrinter.h"
 #include "Stages/FetchStage.h"
 #include "Stages/InstructionTables.h"
 #include "Views/DispatchStatistics.h"
 #include "Views/InstructionInfoView.h"
+#include "Views/InstructionPoolStatistics.h"
+#include "Views/PipelineProfileView.h"
 #include "Views/RegisterFileStatistics.h"
 #include "Views/ResourcePressureView.h"
+#include "Views/ReportWriter.h"
 #include "Views/RetireControlUnitStatistics.h"
 #include "Views/SchedulerStatistics.h"
 #include "Views/SummaryView.h"
+#include "Views/TimelineTraceWriter.h"
 #include "Views/TimelineView.h"
 #include "include/Context.h"
+#include "include/InstrDescCache.h"
 #include "include/Pipeline.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/MCObjectFileInfo.h"
@@ -45,17 +52,24 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/InitLLVM.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/Target/TargetMachine.h"
 
+#include <atomic>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 using namespace llvm;
@@ -71,6 +85,17 @@ static cl::opt<std::string> OutputFilename("o", cl::desc("Output filename"),
                                            cl::init("-"), cl::cat(ToolOptions),
                                            cl::value_desc("filename"));
 
+static cl::opt<mca::OutputFormat> ReportFormat(
+    "output-format", cl::desc("Format of the report"),
+    cl::values(clEnumValN(mca::OutputFormat::Text, "text",
+                          "Human readable text (default)"),
+               clEnumValN(mca::OutputFormat::JSON, "json",
+                          "One JSON object per line for every code region"),
+               clEnumValN(mca::OutputFormat::CSV, "csv",
+                          "One line per value, with columns "
+                          "region,view,table,row,key,value")),
+    cl::cat(ToolOptions), cl::init(mca::OutputFormat::Text));
+
 static cl::opt<std::string>
     ArchName("march", cl::desc("Target arch to assemble for, "
                                "see -version for available targets"),
@@ -86,6 +111,15 @@ static cl::opt<std::string>
          cl::desc("Target a specific cpu type (-mcpu=help for details)"),
          cl::value_desc("cpu-name"), cl::cat(ToolOptions), cl::init("native"));
 
+static cl::list<std::string>
+    MCPUList("mcpu-list",
+             cl::desc("Simulate every code region on each cpu of a comma "
+                      "separated list, and print a table of the results. The "
+                      "input is assembled for the first cpu of the list. "
+                      "Cannot be used with -mcpu"),
+             cl::value_desc("cpu-names"), cl::CommaSeparated,
+             cl::cat(ToolOptions));
+
 static cl::opt<int>
     OutputAsmVariant("output-asm-variant",
                      cl::desc("Syntax variant to use for output printing"),
@@ -119,6 +153,18 @@ static cl::opt<bool>
                      cl::desc("Print summary view (enabled by default)"),
                      cl::cat(ViewOptions), cl::init(true));
 
+static cl::opt<bool> SummaryOnly(
+    "summary-only",
+    cl::desc("Only print the summary view. The simulation runs without any "
+             "other view, and without notifying events"),
+    cl::cat(ViewOptions), cl::init(false));
+
+static cl::opt<bool> TimeStages(
+    "time-stages",
+    cl::desc("Print the time spent in every pipeline stage and event "
+             "listener, and the number of entries scanned by the scheduler"),
+    cl::cat(ViewOptions), cl::init(false));
+
 static cl::opt<bool> PrintSchedulerStats("scheduler-stats",
                                          cl::desc("Print scheduler statistics"),
                                          cl::cat(ViewOptions), cl::init(false));
@@ -128,6 +174,11 @@ static cl::opt<bool>
                      cl::desc("Print retire control unit statistics"),
                      cl::cat(ViewOptions), cl::init(false));
 
+static cl::opt<bool> PrintInstructionPoolStats(
+    "instruction-pool-stats",
+    cl::desc("Print statistics about the allocation of instructions"),
+    cl::cat(ViewOptions), cl::init(false));
+
 static cl::opt<bool> PrintResourcePressureView(
     "resource-pressure",
     cl::desc("Print the resource pressure view (enabled by default)"),
@@ -148,6 +199,21 @@ static cl::opt<unsigned> TimelineMaxCycles(
         "Maximum number of cycles in the timeline view. Defaults to 80 cycles"),
     cl::cat(ViewOptions), cl::init(80));
 
+static cl::opt<std::string> TimelineTrace(
+    "timeline-trace",
+    cl::desc("Stream the timeline of every simulated instruction to a trace "
+             "file. The trace of code region N > 0 is written to "
+             "<stem>.N<extension>"),
+    cl::value_desc("filename"), cl::cat(ViewOptions), cl::init(""));
+
+static cl::opt<mca::TraceFormat> TimelineTraceFormat(
+    "timeline-trace-format", cl::desc("Format of the timeline trace file"),
+    cl::values(clEnumValN(mca::TraceFormat::JSON, "json",
+                          "Chrome trace event format (default)"),
+               clEnumValN(mca::TraceFormat::Binary, "binary",
+                          "Fixed size binary records")),
+    cl::cat(ViewOptions), cl::init(mca::TraceFormat::JSON));
+
 static cl::opt<bool>
     AssumeNoAlias("noalias",
                   cl::desc("If set, assume that loads and stores do not alias"),
@@ -163,6 +229,48 @@ static cl::opt<unsigned>
                    cl::desc("Size of the store queue (unbound by default)"),
                    cl::cat(ToolOptions), cl::init(0));
 
+static cl::opt<bool>
+    EventDriven("event-driven",
+                cl::desc("Skip cycles in which the pipeline is idle"),
+                cl::cat(ToolOptions), cl::init(false));
+
+static cl::opt<bool> ExtrapolateSteadyState(
+    "extrapolate-steady-state",
+    cl::desc("Stop simulating once the pipeline reaches a periodic steady "
+             "state, and extrapolate the remaining iterations (ignored if "
+             "the timeline view or the timeline trace is enabled)"),
+    cl::cat(ToolOptions), cl::init(false));
+
+static cl::opt<unsigned>
+    Jobs("jobs",
+         cl::desc("Number of code regions, or of corpus inputs in corpus "
+                  "mode, to simulate concurrently (0 uses every hardware "
+                  "thread)"),
+         cl::cat(ToolOptions), cl::init(1));
+
+static cl::opt<std::string> CorpusInput(
+    "corpus",
+    cl::desc("Analyze every assembly file (*.s) found in a directory, or every "
+             "file listed in a text file, and write one result file per input"),
+    cl::value_desc("dir|list"), cl::cat(ToolOptions), cl::init(""));
+
+static cl::opt<std::string> CorpusOutputDir(
+    "corpus-output-dir",
+    cl::desc("Directory where corpus mode writes the result (.res) files"),
+    cl::value_desc("dir"), cl::cat(ToolOptions), cl::init("."));
+
+static cl::opt<std::string>
+    CorpusPrefix("corpus-prefix",
+                 cl::desc("Only analyze corpus files whose name starts with "
+                          "this prefix"),
+                 cl::value_desc("prefix"), cl::cat(ToolOptions), cl::init(""));
+
+static cl::opt<std::string> InstrDescCacheDir(
+    "instr-desc-cache",
+    cl::desc("Directory of a persistent cache of instruction descriptors, "
+             "which is reused by later runs for the same target and cpu"),
+    cl::value_desc("dir"), cl::cat(ToolOptions), cl::init(""));
+
 static cl::opt<bool>
     PrintInstructionTables("instruction-tables",
                            cl::desc("Print instruction tables"),
@@ -262,13 +370,14 @@ public:
 };
 
 int AssembleInput(MCAsmParser &Parser, const Target *TheTarget,
-                  MCSubtargetInfo &STI, MCInstrInfo &MCII,
-                  MCTargetOptions &MCOptions) {
+                  const MCSubtargetInfo &STI, const MCInstrInfo &MCII,
+                  MCTargetOptions &MCOptions, raw_ostream &Errs) {
   std::unique_ptr<MCTargetAsmParser> TAP(
       TheTarget->createMCAsmParser(STI, Parser, MCII, MCOptions));
 
   if (!TAP) {
-    WithColor::error() << "this target does not support assembly parsing.\n";
+    WithColor::error(Errs)
+        << "this target does not support assembly parsing.\n";
     return 1;
   }
 
@@ -289,10 +398,11 @@ ErrorOr<std::unique_ptr<ToolOutputFile>> getOutputStream() {
 
 class MCStreamerWrapper final : public MCStreamer {
   mca::CodeRegions &Regions;
+  std::ostream &Log;
 
 public:
-  MCStreamerWrapper(MCContext &Context, mca::CodeRegions &R)
-      : MCStreamer(Context), Regions(R) {}
+  MCStreamerWrapper(MCContext &Context, mca::CodeRegions &R, std::ostream &L)
+      : MCStreamer(Context), Regions(R), Log(L) {}
 
   // We only want to intercept the emission of new instructions.
   virtual void EmitInstruction(const MCInst &Inst, const MCSubtargetInfo &STI,
@@ -304,7 +414,7 @@ public:
     // Check function start
     if (Attribute == MCSA_ELF_TypeFunction) {
       StringRef Name = Symbol->getName();
-      std::cout << "Function Name: " << Name.str() << std::endl;
+      Log << "Function Name: " << Name.str() << std::endl;
       Regions.beginRegion(Name, SMLoc()); 
     }
     return true;
@@ -323,7 +433,7 @@ public:
 
   void EmitCFIEndProcImpl(MCDwarfFrameInfo &Frame) override {
     MCStreamer::EmitCFIEndProcImpl(Frame); 
-    std::cout << "END PROC" << std::endl;
+    Log << "END PROC" << std::endl;
     Regions.endRegion(SMLoc());
   }
   
@@ -361,241 +471,835 @@ static void processViewOptions() {
   processOptionImpl(PrintRetireStats, Default);
 }
 
-int main(int argc, char **argv) {
-  InitLLVM X(argc, argv);
+// Prints the report of Printer to OS. Structured reports are made of a single
+// record for the code region with index RegionIndex.
+static void printRegionReport(const mca::PipelinePrinter &Printer,
+                              const mca::CodeRegion &Region,
+                              unsigned RegionIndex, raw_ostream &OS) {
+  if (ReportFormat == mca::OutputFormat::Text) {
+    Printer.printReport(OS);
+    return;
+  }
 
-  // Initialize targets and assembly parsers.
-  llvm::InitializeAllTargetInfos();
-  llvm::InitializeAllTargetMCs();
-  llvm::InitializeAllAsmParsers();
+  std::unique_ptr<mca::ReportWriter> W =
+      mca::createReportWriter(ReportFormat, OS);
+  W->startRegion(RegionIndex, Region.getDescription());
+  Printer.writeReport(*W);
+  W->endRegion();
+}
 
-  // Enable printing of available targets when flag --version is specified.
-  cl::AddExtraVersionPrinter(TargetRegistry::printRegisteredTargetsForVersion);
+// Returns the name of the timeline trace file of the code region whose index
+// is RegionIndex.
+static std::string getTimelineTraceFilename(unsigned RegionIndex) {
+  if (!RegionIndex)
+    return TimelineTrace;
+  StringRef Extension = sys::path::extension(TimelineTrace);
+  StringRef Stem = StringRef(TimelineTrace).drop_back(Extension.size());
+  return (Stem + "." + Twine(RegionIndex) + Extension).str();
+}
 
-  cl::HideUnrelatedOptions({&ToolOptions, &ViewOptions});
+// Simulates code region Region, whose index is RegionIndex, and prints a
+// report to OS. Target description objects are only read, so this function
+// can run concurrently on different regions, provided that every call uses
+// its own InstrBuilder and instruction printer.
+static Error simulateRegion(const mca::CodeRegion &Region, unsigned RegionIndex,
+                           const mca::PipelineOptions &PO,
+                           const MCSubtargetInfo &STI, const MCInstrInfo &MCII,
+                           const MCRegisterInfo &MRI, mca::InstrBuilder &IB,
+                           MCInstPrinter &IP, raw_ostream &OS) {
+  const MCSchedModel &SM = STI.getSchedModel();
+  mca::SourceMgr S(Region.getInstructions(),
+                   PrintInstructionTables ? 1 : Iterations);
+
+  // Profiling is enabled once every stage has been appended to the pipeline.
+  // The profile view must be added after every other view, so that the time
+  // spent in the other views is accounted for.
+  mca::PipelineProfiler Profiler;
+
+  if (PrintInstructionTables) {
+    // InstructionTables never retires instructions. They are returned to IB
+    // when the FetchStage is destroyed, so the pipeline must go out of scope
+    // before IB is cleared.
+    {
+      //  Create a pipeline, stages, and a printer.
+      auto P = llvm::make_unique<mca::Pipeline>();
+      P->appendStage(llvm::make_unique<mca::FetchStage>(IB, S));
+      P->appendStage(llvm::make_unique<mca::InstructionTables>(SM, IB));
+      if (TimeStages)
+        P->setProfiler(Profiler);
+      mca::PipelinePrinter Printer(*P);
 
-  // Parse flags and initialize target options.
-  cl::ParseCommandLineOptions(argc, argv,
-                              "llvm machine code performance analyzer.\n");
+      // Create the views for this pipeline, execute, and emit a report.
+      if (PrintInstructionInfoView) {
+        Printer.addView(
+            llvm::make_unique<mca::InstructionInfoView>(STI, MCII, S, IP));
+      }
+      Printer.addView(
+          llvm::make_unique<mca::ResourcePressureView>(STI, IP, S));
+      if (TimeStages)
+        Printer.addView(
+            llvm::make_unique<mca::PipelineProfileView>(Profiler));
+      if (auto Err = P->run())
+        return Err;
+      printRegionReport(Printer, Region, RegionIndex, OS);
+    }
+    IB.clear();
+    return ErrorSuccess();
+  }
 
-  MCTargetOptions MCOptions;
-  MCOptions.PreserveAsmComments = false;
+  // Create a context to control ownership of the pipeline hardware.
+  mca::Context MCA(MRI, STI);
+
+  // Create a basic pipeline simulating an out-of-order backend.
+  auto P = MCA.createDefaultPipeline(PO, IB, S);
+  if (TimeStages)
+    P->setProfiler(Profiler);
+  mca::PipelinePrinter Printer(*P);
+
+  if (SummaryOnly) {
+    // No listener is registered with the pipeline. The summary only needs the
+    // number of simulated cycles, and the descriptors of the instructions of
+    // one iteration, which are the same as the ones seen by a SummaryView
+    // observing retired instructions. Stages skip the payload of unobserved
+    // events, so most of the time is still spent in the simulation itself:
+    // on the llvm-mca-bench kernels, this is about 7% faster than a run with
+    // the default views (compare -views=default and -views=summary-only).
+    if (auto Err = P->run())
+      return Err;
+    auto SV = llvm::make_unique<mca::SummaryView>(SM, S, PO.DispatchWidth);
+    for (const std::unique_ptr<const MCInst> &MCI : Region.getInstructions()) {
+      Expected<const mca::InstrDesc &> Desc = IB.getOrCreateInstrDesc(*MCI);
+      if (!Desc)
+        return Desc.takeError();
+      SV->addBlockInstruction(*Desc);
+    }
+    SV->setTotalCycles(P->getNumCycles());
+    Printer.addView(std::move(SV));
+    if (TimeStages)
+      Printer.addView(llvm::make_unique<mca::PipelineProfileView>(Profiler));
+    printRegionReport(Printer, Region, RegionIndex, OS);
+    IB.clear();
+    return ErrorSuccess();
+  }
 
-  // Get the target from the triple. If a triple is not specified, then select
-  // the default triple for the host. If the triple doesn't correspond to any
-  // registered target, then exit with an error message.
-  const char *ProgName = argv[0];
-  const Target *TheTarget = getTarget(ProgName);
-  if (!TheTarget)
-    return 1;
+  if (PrintSummaryView)
+    Printer.addView(
+        llvm::make_unique<mca::SummaryView>(SM, S, PO.DispatchWidth));
 
-  // GetTarget() may replaced TripleName with a default triple.
-  // For safety, reconstruct the Triple object.
-  Triple TheTriple(TripleName);
+  if (PrintInstructionInfoView)
+    Printer.addView(
+        llvm::make_unique<mca::InstructionInfoView>(STI, MCII, S, IP));
 
-  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferPtr =
-      MemoryBuffer::getFileOrSTDIN(InputFilename);
-  if (std::error_code EC = BufferPtr.getError()) {
-    WithColor::error() << InputFilename << ": " << EC.message() << '\n';
-    return 1;
-  }
+  if (PrintDispatchStats)
+    Printer.addView(llvm::make_unique<mca::DispatchStatistics>());
 
-  // Apply overrides to llvm-mca specific options.
-  processViewOptions();
+  if (PrintSchedulerStats)
+    Printer.addView(llvm::make_unique<mca::SchedulerStatistics>(STI));
 
-  SourceMgr SrcMgr;
+  if (PrintRetireStats)
+    Printer.addView(llvm::make_unique<mca::RetireControlUnitStatistics>());
 
-  // Tell SrcMgr about this buffer, which is what the parser will pick up.
-  SrcMgr.AddNewSourceBuffer(std::move(*BufferPtr), SMLoc());
+  if (PrintRegisterFileStats)
+    Printer.addView(llvm::make_unique<mca::RegisterFileStatistics>(STI));
 
-  std::unique_ptr<MCRegisterInfo> MRI(TheTarget->createMCRegInfo(TripleName));
-  assert(MRI && "Unable to create target register info!");
+  if (PrintInstructionPoolStats)
+    Printer.addView(llvm::make_unique<mca::InstructionPoolStatistics>(IB));
 
-  std::unique_ptr<MCAsmInfo> MAI(TheTarget->createMCAsmInfo(*MRI, TripleName));
-  assert(MAI && "Unable to create target asm info!");
+  if (PrintResourcePressureView)
+    Printer.addView(llvm::make_unique<mca::ResourcePressureView>(STI, IP, S));
 
-  MCObjectFileInfo MOFI;
-  MCContext Ctx(MAI.get(), MRI.get(), &MOFI, &SrcMgr);
-  MOFI.InitMCObjectFileInfo(TheTriple, /* PIC= */ false, Ctx);
+  if (PrintTimelineView) {
+    Printer.addView(llvm::make_unique<mca::TimelineView>(
+        STI, IP, S, TimelineMaxIterations, TimelineMaxCycles));
+  }
 
-  std::unique_ptr<buffer_ostream> BOS;
+  // The timeline trace is not a view: it is streamed to its own file while
+  // the pipeline runs.
+  std::unique_ptr<ToolOutputFile> TraceFile;
+  std::unique_ptr<mca::TimelineTraceWriter> Trace;
+  if (!TimelineTrace.empty()) {
+    std::string Filename = getTimelineTraceFilename(RegionIndex);
+    std::error_code EC;
+    TraceFile = llvm::make_unique<ToolOutputFile>(
+        Filename, EC,
+        TimelineTraceFormat == mca::TraceFormat::JSON ? sys::fs::F_Text
+                                                      : sys::fs::F_None);
+    if (EC)
+      return make_error<StringError>(Filename + ": " + EC.message(), EC);
+    Trace = llvm::make_unique<mca::TimelineTraceWriter>(
+        STI, IP, S, Region.getDescription(), TimelineTraceFormat,
+        TraceFile->os());
+    P->addEventListener(Trace.get());
+  }
 
-  mca::CodeRegions Regions(SrcMgr);
-  MCStreamerWrapper Str(Ctx, Regions);
+  if (TimeStages)
+    Printer.addView(llvm::make_unique<mca::PipelineProfileView>(Profiler));
 
-  /* std::unique_ptr<MCStreamer> AsmStreamer;
-  AsmStreamer.reset(&Str);
-  LLVMTargetMachine* LLVMTM = 0;
-  FunctionPass *Printer_ = LLVMTM->getTarget().createAsmPrinter(* LLVMTM, std::move(AsmStreamer));
-  */
-  
-  std::unique_ptr<MCInstrInfo> MCII(TheTarget->createMCInstrInfo());
+  if (auto Err = P->run())
+    return Err;
+  printRegionReport(Printer, Region, RegionIndex, OS);
 
-  std::unique_ptr<MCInstrAnalysis> MCIA(
-      TheTarget->createMCInstrAnalysis(MCII.get()));
+  if (Trace) {
+    Trace->finish();
+    if (TraceFile->os().has_error()) {
+      TraceFile->os().clear_error();
+      return make_error<StringError>(getTimelineTraceFilename(RegionIndex) +
+                                         ": unable to write the trace",
+                                     inconvertibleErrorCode());
+    }
+    TraceFile->keep();
+  }
 
-  if (!MCPU.compare("native"))
-    MCPU = llvm::sys::getHostCPUName();
+  // Clear the InstrBuilder internal state in preparation for another round.
+  IB.clear();
+  return ErrorSuccess();
+}
+
+namespace {
+// Target description objects. They are created once, and only read while
+// inputs are assembled and simulated, so they can be shared by concurrent
+// analyses of different inputs.
+struct TargetObjects {
+  const Target *TheTarget;
+  MCTargetOptions MCOptions;
+  std::unique_ptr<MCRegisterInfo> MRI;
+  std::unique_ptr<MCAsmInfo> MAI;
+  std::unique_ptr<MCInstrInfo> MCII;
+  std::unique_ptr<MCInstrAnalysis> MCIA;
+  std::unique_ptr<MCSubtargetInfo> STI;
+  // One subtarget per cpu of the -mcpu-list sweep.
+  std::vector<std::unique_ptr<MCSubtargetInfo>> SweepTargets;
+  // Persistent descriptor caches for STI and for every subtarget of the
+  // sweep. They are only created if -instr-desc-cache is specified.
+  std::unique_ptr<mca::InstrDescCache> DescCache;
+  std::vector<std::unique_ptr<mca::InstrDescCache>> SweepCaches;
+};
+} // end of anonymous namespace
 
+// Creates the subtarget for CPU. Returns null if CPU cannot be simulated.
+static std::unique_ptr<MCSubtargetInfo> createSubtarget(const Target *TheTarget,
+                                                        StringRef CPU) {
   std::unique_ptr<MCSubtargetInfo> STI(
-      TheTarget->createMCSubtargetInfo(TripleName, MCPU, /* FeaturesStr */ ""));
-  if (!STI->isCPUStringValid(MCPU))
-    return 1;
+      TheTarget->createMCSubtargetInfo(TripleName, CPU, /* FeaturesStr */ ""));
+  if (!STI->isCPUStringValid(CPU))
+    return nullptr;
 
   if (!PrintInstructionTables && !STI->getSchedModel().isOutOfOrder()) {
-    WithColor::error() << "please specify an out-of-order cpu. '" << MCPU
+    WithColor::error() << "please specify an out-of-order cpu. '" << CPU
                        << "' is an in-order cpu.\n";
-    return 1;
+    return nullptr;
   }
 
   if (!STI->getSchedModel().hasInstrSchedModel()) {
     WithColor::error()
         << "unable to find instruction-level scheduling information for"
-        << " target triple '" << TheTriple.normalize() << "' and cpu '" << MCPU
-        << "'.\n";
+        << " target triple '" << Triple(TripleName).normalize()
+        << "' and cpu '" << CPU << "'.\n";
 
     if (STI->getSchedModel().InstrItineraries)
       WithColor::note()
-          << "cpu '" << MCPU << "' provides itineraries. However, "
+          << "cpu '" << CPU << "' provides itineraries. However, "
           << "instruction itineraries are currently unsupported.\n";
-    return 1;
+    return nullptr;
+  }
+
+  return STI;
+}
+
+// Creates the target description objects for the selected triple and cpus.
+// Returns false if a cpu cannot be simulated.
+static bool createTargetObjects(const Target *TheTarget, TargetObjects &T) {
+  T.TheTarget = TheTarget;
+  T.MCOptions.PreserveAsmComments = false;
+
+  T.MRI.reset(TheTarget->createMCRegInfo(TripleName));
+  assert(T.MRI && "Unable to create target register info!");
+
+  T.MAI.reset(TheTarget->createMCAsmInfo(*T.MRI, TripleName));
+  assert(T.MAI && "Unable to create target asm info!");
+
+  T.MCII.reset(TheTarget->createMCInstrInfo());
+  T.MCIA.reset(TheTarget->createMCInstrAnalysis(T.MCII.get()));
+
+  // Like -mcpu, every cpu of the sweep may be the 'native' host cpu. The
+  // input is assembled for the first cpu of the sweep.
+  for (std::string &CPU : MCPUList) {
+    if (CPU == "native")
+      CPU = llvm::sys::getHostCPUName();
+  }
+  if (!MCPUList.empty())
+    MCPU = MCPUList.front();
+
+  if (!MCPU.compare("native"))
+    MCPU = llvm::sys::getHostCPUName();
+
+  T.STI = createSubtarget(TheTarget, MCPU);
+  if (!T.STI)
+    return false;
+
+  for (const std::string &CPU : MCPUList) {
+    std::unique_ptr<MCSubtargetInfo> STI = createSubtarget(TheTarget, CPU);
+    if (!STI)
+      return false;
+    T.SweepTargets.emplace_back(std::move(STI));
+  }
+
+  if (!InstrDescCacheDir.empty()) {
+    T.DescCache =
+        mca::InstrDescCache::open(InstrDescCacheDir, TripleName, *T.STI,
+                                  *T.MCII);
+    for (const std::unique_ptr<MCSubtargetInfo> &STI : T.SweepTargets)
+      T.SweepCaches.emplace_back(mca::InstrDescCache::open(
+          InstrDescCacheDir, TripleName, *STI, *T.MCII));
+  }
+
+  return true;
+}
+
+// Writes the descriptors created during this run to the persistent caches.
+// A failure only affects later runs, so it is reported as a warning.
+static void saveDescriptorCaches(TargetObjects &T) {
+  auto Save = [](mca::InstrDescCache *Cache) {
+    if (!Cache)
+      return;
+    if (Error Err = Cache->save())
+      WithColor::warning() << "unable to update the descriptor cache: "
+                           << toString(std::move(Err)) << '\n';
+  };
+
+  Save(T.DescCache.get());
+  for (std::unique_ptr<mca::InstrDescCache> &Cache : T.SweepCaches)
+    Save(Cache.get());
+}
+
+// Returns the pipeline options used to simulate a code region on STI.
+static mca::PipelineOptions getPipelineOptions(const MCSubtargetInfo &STI) {
+  unsigned Width = STI.getSchedModel().IssueWidth;
+  if (DispatchWidth)
+    Width = DispatchWidth;
+
+  // The timeline view and the timeline trace record individual instructions,
+  // so they cannot be extrapolated.
+  return mca::PipelineOptions(Width, RegisterFileSize, LoadQueueSize,
+                              StoreQueueSize, AssumeNoAlias, EventDriven,
+                              ExtrapolateSteadyState && !PrintTimelineView &&
+                                  TimelineTrace.empty());
+}
+
+// Simulates every code region in RegionList on every cpu of the -mcpu-list
+// sweep, and prints a table of the total cycles and IPC of every region on
+// every cpu. Simulations are distributed among NumJobs concurrent jobs, and
+// each of them uses its own InstrBuilder and Context.
+static bool
+printCPUSweep(ArrayRef<const mca::CodeRegion *> RegionList,
+              const TargetObjects &T,
+              function_ref<std::unique_ptr<MCInstPrinter>()> CreateInstPrinter,
+              unsigned NumJobs, raw_ostream &OS, raw_ostream &Errs) {
+  unsigned NumCPUs = T.SweepTargets.size();
+  unsigned NumTasks = RegionList.size() * NumCPUs;
+  std::vector<unsigned> Cycles(NumTasks);
+  std::vector<unsigned> Executed(NumTasks);
+  std::vector<std::string> Failures(NumTasks);
+  // Diagnostics of every task, printed in task order once every simulation
+  // has completed.
+  std::vector<std::string> Diagnostics(NumTasks);
+
+  auto Simulate = [&](unsigned Task) {
+    const mca::CodeRegion &Region = *RegionList[Task / NumCPUs];
+    const MCSubtargetInfo &STI = *T.SweepTargets[Task % NumCPUs];
+    if (Region.empty())
+      return;
+
+    std::unique_ptr<MCInstPrinter> IP = CreateInstPrinter();
+    mca::InstrBuilder IB(STI, *T.MCII, *T.MRI, *T.MCIA, *IP);
+    if (!T.SweepCaches.empty())
+      IB.setDescriptorCache(T.SweepCaches[Task % NumCPUs].get());
+    raw_string_ostream DiagOS(Diagnostics[Task]);
+    IB.setDiagnosticStream(DiagOS);
+    mca::Context MCA(*T.MRI, STI);
+    mca::SourceMgr S(Region.getInstructions(), Iterations);
+    auto P = MCA.createDefaultPipeline(getPipelineOptions(STI), IB, S);
+    if (Error Err = P->run()) {
+      Failures[Task] = toString(std::move(Err));
+      return;
+    }
+    Cycles[Task] = P->getNumCycles();
+    Executed[Task] = S.getNumIterations() * S.size();
+  };
+
+  if (NumJobs > 1) {
+    ThreadPool Pool(std::min(NumJobs, NumTasks));
+    for (unsigned I = 0; I < NumTasks; ++I)
+      Pool.async(Simulate, I);
+    Pool.wait();
+  } else {
+    for (unsigned I = 0; I < NumTasks; ++I)
+      Simulate(I);
+  }
+
+  for (unsigned I = 0; I < NumTasks; ++I) {
+    Errs << Diagnostics[I];
+    const std::string &Failure = Failures[I];
+    if (!Failure.empty()) {
+      WithColor::error(Errs) << Failure << '\n';
+      return false;
+    }
   }
 
-  std::unique_ptr<MCAsmParser> P(createMCAsmParser(SrcMgr, Ctx, Str, *MAI));
+  // Structured reports have one record per non-empty region, with one row
+  // per cpu.
+  if (ReportFormat != mca::OutputFormat::Text) {
+    std::unique_ptr<mca::ReportWriter> W =
+        mca::createReportWriter(ReportFormat, OS);
+    mca::printReportHeader(ReportFormat, OS);
+    for (unsigned I = 0, E = RegionList.size(); I < E; ++I) {
+      if (RegionList[I]->empty())
+        continue;
+      W->startRegion(I, RegionList[I]->getDescription());
+      W->startView("CPUSweep");
+      W->startTable("CPUs");
+      for (unsigned J = 0; J < NumCPUs; ++J) {
+        unsigned Task = I * NumCPUs + J;
+        W->startRow();
+        W->writeString("CPU", MCPUList[J]);
+        W->writeInteger("TotalCycles", Cycles[Task]);
+        W->writeNumber("IPC", (double)Executed[Task] / Cycles[Task]);
+        W->endRow();
+      }
+      W->endTable();
+      W->endView();
+      W->endRegion();
+    }
+    return true;
+  }
+
+  // Regions are labeled by their index and description.
+  std::vector<std::string> Labels;
+  unsigned LabelWidth = 0;
+  for (unsigned I = 0, E = RegionList.size(); I < E; ++I) {
+    std::string Label = "[" + std::to_string(I) + "]";
+    StringRef Desc = RegionList[I]->getDescription();
+    if (!Desc.empty())
+      Label += " " + Desc.str();
+    LabelWidth = std::max<unsigned>(LabelWidth, Label.size());
+    Labels.emplace_back(std::move(Label));
+  }
+
+  formatted_raw_ostream FOS(OS);
+  auto PrintTable = [&](StringRef Title, bool PrintIPC) {
+    FOS << '\n' << Title << ":\n";
+    unsigned Column = LabelWidth + 2;
+    FOS << "Region";
+    for (const std::string &CPU : MCPUList) {
+      FOS.PadToColumn(Column);
+      FOS << CPU;
+      Column += std::max<unsigned>(CPU.size(), 8) + 2;
+    }
+    FOS << '\n';
+
+    for (unsigned I = 0, E = RegionList.size(); I < E; ++I) {
+      FOS << Labels[I];
+      Column = LabelWidth + 2;
+      for (unsigned J = 0; J < NumCPUs; ++J) {
+        FOS.PadToColumn(Column);
+        unsigned Task = I * NumCPUs + J;
+        if (RegionList[I]->empty())
+          FOS << '-';
+        else if (PrintIPC)
+          FOS << format("%.2f", (double)Executed[Task] / Cycles[Task]);
+        else
+          FOS << Cycles[Task];
+        Column += std::max<unsigned>(MCPUList[J].size(), 8) + 2;
+      }
+      FOS << '\n';
+    }
+  };
+
+  PrintTable("Total Cycles", /* PrintIPC */ false);
+  PrintTable("IPC", /* PrintIPC */ true);
+  return true;
+}
+
+static void printDiagnostic(const SMDiagnostic &Diag, void *Context) {
+  Diag.print(nullptr, *static_cast<raw_ostream *>(Context));
+}
+
+// Assembles the input in Buffer, simulates every code region in it, and
+// prints a report to the stream returned by GetOutput. That stream is only
+// requested once the input has been successfully assembled. Progress messages
+// are written to Log, and diagnostics to Errs. Code regions are simulated by
+// NumJobs concurrent jobs. Returns false on error.
+static bool analyzeInput(std::unique_ptr<MemoryBuffer> Buffer,
+                         const TargetObjects &T, unsigned NumJobs,
+                         function_ref<raw_ostream *()> GetOutput,
+                         std::ostream &Log, raw_ostream &Errs) {
+  const Target *TheTarget = T.TheTarget;
+  const MCSubtargetInfo &STI = *T.STI;
+  Triple TheTriple(TripleName);
+
+  SourceMgr SrcMgr;
+  SrcMgr.setDiagHandler(printDiagnostic, &Errs);
+
+  // Tell SrcMgr about this buffer, which is what the parser will pick up.
+  SrcMgr.AddNewSourceBuffer(std::move(Buffer), SMLoc());
+
+  MCObjectFileInfo MOFI;
+  MCContext Ctx(T.MAI.get(), T.MRI.get(), &MOFI, &SrcMgr);
+  MOFI.InitMCObjectFileInfo(TheTriple, /* PIC= */ false, Ctx);
+
+  mca::CodeRegions Regions(SrcMgr);
+  MCStreamerWrapper Str(Ctx, Regions, Log);
+
+  std::unique_ptr<MCAsmParser> P(createMCAsmParser(SrcMgr, Ctx, Str, *T.MAI));
   MCAsmLexer &Lexer = P->getLexer();
   MCACommentConsumer CC(Regions);
   Lexer.setCommentConsumer(&CC);
 
-  if (AssembleInput(*P, TheTarget, *STI, *MCII, MCOptions))
-    return 1;
+  MCTargetOptions MCOptions = T.MCOptions;
+  if (AssembleInput(*P, TheTarget, STI, *T.MCII, MCOptions, Errs))
+    return false;
 
   if (Regions.empty()) {
-    WithColor::error() << "no assembly instructions found.\n";
-    return 1;
-  }
-
-  // Now initialize the output file.
-  auto OF = getOutputStream();
-  if (std::error_code EC = OF.getError()) {
-    WithColor::error() << EC.message() << '\n';
-    return 1;
+    WithColor::error(Errs) << "no assembly instructions found.\n";
+    return false;
   }
 
   unsigned AssemblerDialect = P->getAssemblerDialect();
   if (OutputAsmVariant >= 0)
     AssemblerDialect = static_cast<unsigned>(OutputAsmVariant);
-  std::unique_ptr<MCInstPrinter> IP(TheTarget->createMCInstPrinter(
-      Triple(TripleName), AssemblerDialect, *MAI, *MCII, *MRI));
+  auto CreateInstPrinter = [&]() {
+    return std::unique_ptr<MCInstPrinter>(TheTarget->createMCInstPrinter(
+        TheTriple, AssemblerDialect, *T.MAI, *T.MCII, *T.MRI));
+  };
+  std::unique_ptr<MCInstPrinter> IP = CreateInstPrinter();
   if (!IP) {
-    WithColor::error()
+    WithColor::error(Errs)
         << "unable to create instruction printer for target triple '"
         << TheTriple.normalize() << "' with assembly variant "
         << AssemblerDialect << ".\n";
-    return 1;
+    return false;
   }
 
-  std::unique_ptr<llvm::ToolOutputFile> TOF = std::move(*OF);
-
-  const MCSchedModel &SM = STI->getSchedModel();
-
-  unsigned Width = SM.IssueWidth;
-  if (DispatchWidth)
-    Width = DispatchWidth;
+  // Now initialize the output stream.
+  raw_ostream *OS = GetOutput();
+  if (!OS)
+    return false;
+
+  std::vector<const mca::CodeRegion *> RegionList;
+  for (const std::unique_ptr<mca::CodeRegion> &Region : Regions)
+    RegionList.push_back(Region.get());
+
+  if (!T.SweepTargets.empty())
+    return printCPUSweep(RegionList, T, CreateInstPrinter, NumJobs, *OS, Errs);
+
+  mca::PipelineOptions PO = getPipelineOptions(STI);
+
+  // When simulating regions concurrently, every region is simulated by an
+  // independent InstrBuilder and instruction printer, and its report is
+  // buffered. Reports are then printed in the original region order, so the
+  // output doesn't depend on the number of jobs.
+  std::vector<std::string> Reports;
+  std::vector<std::string> Diagnostics;
+  std::vector<std::string> Failures;
+  if (NumJobs > 1 && RegionList.size() > 1) {
+    Reports.resize(RegionList.size());
+    Diagnostics.resize(RegionList.size());
+    Failures.resize(RegionList.size());
+    ThreadPool Pool(std::min<unsigned>(NumJobs, RegionList.size()));
+    for (unsigned I = 0, E = RegionList.size(); I < E; ++I) {
+      if (RegionList[I]->empty())
+        continue;
+      Pool.async([&, I]() {
+        std::unique_ptr<MCInstPrinter> RegionIP = CreateInstPrinter();
+        mca::InstrBuilder RegionIB(STI, *T.MCII, *T.MRI, *T.MCIA, *RegionIP);
+        RegionIB.setDescriptorCache(T.DescCache.get());
+        raw_string_ostream RegionDiagOS(Diagnostics[I]);
+        RegionIB.setDiagnosticStream(RegionDiagOS);
+        raw_string_ostream RegionOS(Reports[I]);
+        if (Error Err =
+                simulateRegion(*RegionList[I], I, PO, STI, *T.MCII, *T.MRI,
+                               RegionIB, *RegionIP, RegionOS))
+          Failures[I] = toString(std::move(Err));
+      });
+    }
+    Pool.wait();
+  }
 
   // Create an instruction builder.
-  mca::InstrBuilder IB(*STI, *MCII, *MRI, *MCIA, *IP);
+  mca::InstrBuilder IB(STI, *T.MCII, *T.MRI, *T.MCIA, *IP);
+  IB.setDescriptorCache(T.DescCache.get());
+  IB.setDiagnosticStream(Errs);
 
-  // Create a context to control ownership of the pipeline hardware.
-  mca::Context MCA(*MRI, *STI);
-
-  mca::PipelineOptions PO(Width, RegisterFileSize, LoadQueueSize,
-                          StoreQueueSize, AssumeNoAlias);
+  if (ReportFormat != mca::OutputFormat::Text)
+    mca::printReportHeader(ReportFormat, *OS);
 
   // Number each region in the sequence.
   unsigned RegionIdx = 0;
-  for (const std::unique_ptr<mca::CodeRegion> &Region : Regions) {
+  for (unsigned I = 0, E = RegionList.size(); I < E; ++I) {
+    const mca::CodeRegion &Region = *RegionList[I];
     // Skip empty code regions.
-    if (Region->empty()) {
-      std::cout << "Empty Region?";
+    if (Region.empty()) {
+      Log << "Empty Region?";
       continue;
     } else
-      std::cout << "Proc Region: " << Region->getDescription().str() << std::endl;
+      Log << "Proc Region: " << Region.getDescription().str() << std::endl;
 
     // Don't print the header of this region if it is the default region, and
-    // it doesn't have an end location.
-    if (Region->startLoc().isValid() || Region->endLoc().isValid()) {
-      TOF->os() << "\n[" << RegionIdx++ << "] Code Region";
-      StringRef Desc = Region->getDescription();
+    // it doesn't have an end location. Structured reports identify regions
+    // in their records.
+    if (ReportFormat == mca::OutputFormat::Text &&
+        (Region.startLoc().isValid() || Region.endLoc().isValid())) {
+      *OS << "\n[" << RegionIdx++ << "] Code Region";
+      StringRef Desc = Region.getDescription();
       if (!Desc.empty())
-        TOF->os() << " - " << Desc;
-      TOF->os() << "\n\n";
+        *OS << " - " << Desc;
+      *OS << "\n\n";
     }
 
-    mca::SourceMgr S(Region->getInstructions(),
-                     PrintInstructionTables ? 1 : Iterations);
+    if (!Reports.empty()) {
+      Errs << Diagnostics[I];
+      if (!Failures[I].empty()) {
+        WithColor::error(Errs) << Failures[I] << '\n';
+        return false;
+      }
+      *OS << Reports[I];
+      std::string().swap(Reports[I]);
+      OS->flush();
+      continue;
+    }
 
-    if (PrintInstructionTables) {
-      //  Create a pipeline, stages, and a printer.
-      auto P = llvm::make_unique<mca::Pipeline>();
-      P->appendStage(llvm::make_unique<mca::FetchStage>(IB, S));
-      P->appendStage(llvm::make_unique<mca::InstructionTables>(SM, IB));
-      mca::PipelinePrinter Printer(*P);
+    if (Error Err = simulateRegion(Region, I, PO, STI, *T.MCII, *T.MRI, IB,
+                                   *IP, *OS)) {
+      WithColor::error(Errs) << toString(std::move(Err)) << '\n';
+      return false;
+    }
 
-      // Create the views for this pipeline, execute, and emit a report.
-      if (PrintInstructionInfoView) {
-        Printer.addView(
-            llvm::make_unique<mca::InstructionInfoView>(*STI, *MCII, S, *IP));
-      }
-      Printer.addView(
-          llvm::make_unique<mca::ResourcePressureView>(*STI, *IP, S));
-      auto Err = P->run();
-      if (Err)
-        report_fatal_error(toString(std::move(Err)));
-      Printer.printReport(TOF->os());
+    // Make the report of this region available to readers of the output
+    // before the next region is simulated.
+    OS->flush();
+  }
+
+  return true;
+}
+
+// Corpus mode. Analyzes every input selected by -corpus, and writes the
+// report of each input to its own result file. Inputs that already have a
+// result file are skipped, so an interrupted run can be resumed.
+static int analyzeCorpus(const TargetObjects &T, unsigned NumJobs) {
+  Expected<std::vector<std::string>> InputsOrErr =
+      mca::collectCorpusInputs(CorpusInput, CorpusPrefix);
+  if (!InputsOrErr) {
+    WithColor::error() << toString(InputsOrErr.takeError()) << '\n';
+    return 1;
+  }
+
+  if (std::error_code EC = sys::fs::create_directories(CorpusOutputDir)) {
+    WithColor::error() << CorpusOutputDir << ": " << EC.message() << '\n';
+    return 1;
+  }
+
+  // Result files mirror the layout of a corpus directory. Inputs listed in a
+  // file are named after their file name only, so two of them may still map
+  // to the same result file. Workers would then overwrite each other's
+  // results, so this is reported as an error.
+  StringRef Root;
+  if (sys::fs::is_directory(CorpusInput))
+    Root = CorpusInput;
+  StringMap<StringRef> ResultOwners;
+  std::vector<std::string> AllResults;
+  for (const std::string &Input : *InputsOrErr) {
+    AllResults.push_back(
+        mca::getCorpusResultPath(Input, Root, CorpusOutputDir));
+    auto It = ResultOwners.insert(
+        std::make_pair(StringRef(AllResults.back()), StringRef(Input)));
+    if (!It.second) {
+      WithColor::error() << "inputs " << It.first->second << " and " << Input
+                         << " have the same result file " << AllResults.back()
+                         << '\n';
+      return 1;
+    }
+  }
+
+  // Select the inputs that don't have a result yet.
+  std::vector<std::string> Inputs;
+  std::vector<std::string> Results;
+  unsigned NumSkipped = 0;
+  for (unsigned I = 0, E = AllResults.size(); I < E; ++I) {
+    const std::string &Input = (*InputsOrErr)[I];
+    std::string &Result = AllResults[I];
+    if (sys::fs::exists(Result)) {
+      ++NumSkipped;
       continue;
     }
+    Inputs.push_back(Input);
+    Results.push_back(std::move(Result));
+  }
 
-    // Create a basic pipeline simulating an out-of-order backend.
-    auto P = MCA.createDefaultPipeline(PO, IB, S);
-    mca::PipelinePrinter Printer(*P);
+  // Diagnostics that go to stderr rather than to a result file. Workers only
+  // write to the entry of their own input. Entries are printed in input order
+  // once every worker has completed.
+  std::vector<std::string> StderrDiagnostics(Inputs.size());
+
+  std::atomic<unsigned> NumFailed(0);
+  mca::runWorkStealing(Inputs.size(), NumJobs, [&](unsigned I) {
+    // Everything that the tool would print for this input goes to the result
+    // file, in the same order as a standalone invocation with stdout and
+    // stderr redirected to that file.
+    raw_string_ostream StderrOS(StderrDiagnostics[I]);
+    std::ostringstream Log;
+    std::string Diagnostics;
+    raw_string_ostream Errs(Diagnostics);
+    std::string Report;
+    raw_string_ostream ReportOS(Report);
+
+    bool Success = false;
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufferPtr =
+        MemoryBuffer::getFile(Inputs[I]);
+    if (std::error_code EC = BufferPtr.getError()) {
+      WithColor::error(Errs) << Inputs[I] << ": " << EC.message() << '\n';
+    } else {
+      Success = analyzeInput(std::move(*BufferPtr), T, /* NumJobs */ 1,
+                             [&]() -> raw_ostream * { return &ReportOS; },
+                             Log, Errs);
+    }
+    if (!Success)
+      ++NumFailed;
+
+    // Structured result files only contain the report, and diagnostics are
+    // printed to stderr. A failed input has no complete report, so no result
+    // file is created for it. That way, the next run analyzes it again.
+    if (ReportFormat != mca::OutputFormat::Text) {
+      StderrOS << Errs.str();
+      if (!Success)
+        return;
+    }
 
-    if (PrintSummaryView)
-      Printer.addView(llvm::make_unique<mca::SummaryView>(SM, S, Width));
+    std::error_code EC =
+        sys::fs::create_directories(sys::path::parent_path(Results[I]));
+    if (EC) {
+      WithColor::error(StderrOS) << Results[I] << ": " << EC.message() << '\n';
+      ++NumFailed;
+      return;
+    }
+    raw_fd_ostream Out(Results[I], EC, sys::fs::F_None);
+    if (EC) {
+      WithColor::error(StderrOS) << Results[I] << ": " << EC.message() << '\n';
+      ++NumFailed;
+      return;
+    }
+    if (ReportFormat == mca::OutputFormat::Text)
+      Out << Log.str() << Errs.str();
+    Out << ReportOS.str();
+  });
+
+  for (const std::string &Diagnostics : StderrDiagnostics)
+    errs() << Diagnostics;
+
+  WithColor::note() << "analyzed " << Inputs.size() << " inputs ("
+                    << NumFailed << " failed), skipped " << NumSkipped
+                    << " inputs with existing results.\n";
+  return NumFailed ? 1 : 0;
+}
 
-    if (PrintInstructionInfoView)
-      Printer.addView(
-          llvm::make_unique<mca::InstructionInfoView>(*STI, *MCII, S, *IP));
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
 
-    if (PrintDispatchStats)
-      Printer.addView(llvm::make_unique<mca::DispatchStatistics>());
+  // Initialize targets and assembly parsers.
+  llvm::InitializeAllTargetInfos();
+  llvm::InitializeAllTargetMCs();
+  llvm::InitializeAllAsmParsers();
 
-    if (PrintSchedulerStats)
-      Printer.addView(llvm::make_unique<mca::SchedulerStatistics>(*STI));
+  // Enable printing of available targets when flag --version is specified.
+  cl::AddExtraVersionPrinter(TargetRegistry::printRegisteredTargetsForVersion);
 
-    if (PrintRetireStats)
-      Printer.addView(llvm::make_unique<mca::RetireControlUnitStatistics>());
+  cl::HideUnrelatedOptions({&ToolOptions, &ViewOptions});
 
-    if (PrintRegisterFileStats)
-      Printer.addView(llvm::make_unique<mca::RegisterFileStatistics>(*STI));
+  // Parse flags and initialize target options.
+  cl::ParseCommandLineOptions(argc, argv,
+                              "llvm machine code performance analyzer.\n");
 
-    if (PrintResourcePressureView)
-      Printer.addView(
-          llvm::make_unique<mca::ResourcePressureView>(*STI, *IP, S));
+  // Get the target from the triple. If a triple is not specified, then select
+  // the default triple for the host. If the triple doesn't correspond to any
+  // registered target, then exit with an error message.
+  const char *ProgName = argv[0];
+  const Target *TheTarget = getTarget(ProgName);
+  if (!TheTarget)
+    return 1;
 
-    if (PrintTimelineView) {
-      Printer.addView(llvm::make_unique<mca::TimelineView>(
-          *STI, *IP, S, TimelineMaxIterations, TimelineMaxCycles));
+  unsigned NumJobs = Jobs ? Jobs : llvm::hardware_concurrency();
+
+  std::unique_ptr<MemoryBuffer> Buffer;
+  if (CorpusInput.empty()) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufferPtr =
+        MemoryBuffer::getFileOrSTDIN(InputFilename);
+    if (std::error_code EC = BufferPtr.getError()) {
+      WithColor::error() << InputFilename << ": " << EC.message() << '\n';
+      return 1;
     }
+    Buffer = std::move(*BufferPtr);
+  }
 
-    auto Err = P->run();
-    if (Err)
-      report_fatal_error(toString(std::move(Err)));
-    Printer.printReport(TOF->os());
+  // Apply overrides to llvm-mca specific options.
+  processViewOptions();
 
-    // Clear the InstrBuilder internal state in preparation for another round.
-    IB.clear();
+  if (SummaryOnly && PrintInstructionTables) {
+    WithColor::error()
+        << "-summary-only cannot be used with -instruction-tables.\n";
+    return 1;
+  }
+
+  if (!TimelineTrace.empty() &&
+      (PrintInstructionTables || SummaryOnly || !MCPUList.empty() ||
+       !CorpusInput.empty())) {
+    WithColor::error() << "-timeline-trace cannot be used with "
+                          "-instruction-tables, -summary-only, -mcpu-list or "
+                          "-corpus.\n";
+    return 1;
+  }
+
+  if (!MCPUList.empty() && MCPU.getNumOccurrences()) {
+    WithColor::error() << "-mcpu cannot be used with -mcpu-list.\n";
+    return 1;
+  }
+
+  if (!MCPUList.empty() && PrintInstructionTables) {
+    WithColor::error()
+        << "-mcpu-list cannot be used with -instruction-tables.\n";
+    return 1;
   }
 
+  TargetObjects T;
+  if (!createTargetObjects(TheTarget, T))
+    return 1;
+
+  if (!CorpusInput.empty()) {
+    int Ret = analyzeCorpus(T, NumJobs);
+    saveDescriptorCaches(T);
+    return Ret;
+  }
+
+  std::unique_ptr<ToolOutputFile> TOF;
+  auto GetOutput = [&]() -> raw_ostream * {
+    auto OF = getOutputStream();
+    if (std::error_code EC = OF.getError()) {
+      WithColor::error() << EC.message() << '\n';
+      return nullptr;
+    }
+    TOF = std::move(*OF);
+    return &TOF->os();
+  };
+
+  // Progress messages are not printed with structured reports, since they
+  // could be interleaved with the report on stdout.
+  std::ostream NullLog(nullptr);
+  std::ostream &Log =
+      ReportFormat == mca::OutputFormat::Text ? std::cout : NullLog;
+  bool Success =
+      analyzeInput(std::move(Buffer), T, NumJobs, GetOutput, Log, errs());
+  saveDescriptorCaches(T);
+  if (!Success)
+    return 1;
+
   TOF->keep();
   return 0;
 }